@@ -0,0 +1,188 @@
+/**
+    ====================================================================================================================
+    
+    This work is free. You can redistribute it and/or modify it under the
+    terms of the Do What The Fuck You Want To Public License, Version 2,
+    as published by Sam Hocevar. See the COPYING file or http://www.wtfpl.net/ 
+    for more details.
+    
+    ====================================================================================================================
+    
+    @author Elanda
+    @file   aoc_mapped_file.h
+    @date   06, December 2022
+    
+    ====================================================================================================================
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define AOC_HAS_MMAP 1
+    
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #define AOC_HAS_MMAP 0
+    
+    #include <fstream>
+    #include <vector>
+#endif
+
+
+
+namespace aoc
+{
+    // A read-only view over a whole input file.
+    // On POSIX systems the file is memory-mapped, anywhere else it will simply be read into a buffer at once,
+    // either way there won't be any line or string copies on our side.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &file)
+        {
+        #if AOC_HAS_MMAP
+            const int fd = ::open(file.c_str(), O_RDONLY);
+            
+            if (fd < 0)
+            {
+                throw std::runtime_error("File '" + file + "' not found");
+            }
+            
+            struct stat info {};
+            
+            if (::fstat(fd, &info) != 0)
+            {
+                (void) ::close(fd);
+                throw std::runtime_error("File '" + file + "' could not be inspected");
+            }
+            
+            length = static_cast<std::size_t>(info.st_size);
+            
+            if (length > 0)
+            {
+                void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                
+                if (mapping == MAP_FAILED)
+                {
+                    (void) ::close(fd);
+                    throw std::runtime_error("File '" + file + "' could not be mapped");
+                }
+                
+                (void) ::madvise(mapping, length, MADV_SEQUENTIAL);
+                content = static_cast<const char*>(mapping);
+            }
+            
+            (void) ::close(fd);
+        #else
+            std::ifstream input(file, std::ios::binary | std::ios::ate);
+            
+            if (!input.is_open())
+            {
+                throw std::runtime_error("File '" + file + "' not found");
+            }
+            
+            buffer.resize(static_cast<std::size_t>(input.tellg()));
+            (void) input.seekg(0);
+            (void) input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            
+            content = buffer.data();
+            length  = buffer.size();
+        #endif
+        }
+        
+        MappedFile(MappedFile &&other) noexcept
+            : content(std::exchange(other.content, nullptr)),
+              length (std::exchange(other.length,  0))
+        #if !AOC_HAS_MMAP
+            , buffer(std::move(other.buffer))
+        #endif
+        {}
+        
+        ~MappedFile()
+        {
+            release();
+        }
+        
+        //==============================================================================================================
+        MappedFile& operator=(MappedFile &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                
+                content = std::exchange(other.content, nullptr);
+                length  = std::exchange(other.length,  0);
+            #if !AOC_HAS_MMAP
+                buffer  = std::move(other.buffer);
+            #endif
+            }
+            
+            return *this;
+        }
+        
+        MappedFile(const MappedFile&)            = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        const char* data() const noexcept
+        {
+            return content;
+        }
+        
+        [[nodiscard]]
+        std::size_t size() const noexcept
+        {
+            return length;
+        }
+        
+        [[nodiscard]]
+        std::string_view view() const noexcept
+        {
+            return { content, length };
+        }
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        const char* begin() const noexcept
+        {
+            return content;
+        }
+        
+        [[nodiscard]]
+        const char* end() const noexcept
+        {
+            return content + length;
+        }
+        
+    private:
+        const char  *content { nullptr };
+        std::size_t length   { 0 };
+    #if !AOC_HAS_MMAP
+        std::vector<char> buffer;
+    #endif
+        
+        //==============================================================================================================
+        void release() noexcept
+        {
+        #if AOC_HAS_MMAP
+            if (content != nullptr)
+            {
+                (void) ::munmap(const_cast<char*>(content), length); // NOLINT
+            }
+        #endif
+            
+            content = nullptr;
+            length  = 0;
+        }
+    };
+}
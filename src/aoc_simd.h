@@ -0,0 +1,126 @@
+/**
+    ====================================================================================================================
+    
+    This work is free. You can redistribute it and/or modify it under the
+    terms of the Do What The Fuck You Want To Public License, Version 2,
+    as published by Sam Hocevar. See the COPYING file or http://www.wtfpl.net/ 
+    for more details.
+    
+    ====================================================================================================================
+    
+    @author Elanda
+    @file   aoc_simd.h
+    @date   06, December 2022
+    
+    ====================================================================================================================
+ */
+
+#pragma once
+
+#include "aoc_utility.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// SSE2 is part of every x86-64 cpu, so if we are on one we can use it without any further checks
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define AOC_HAS_SSE2 1
+    
+    #include <emmintrin.h>
+#else
+    #define AOC_HAS_SSE2 0
+#endif
+
+// AVX2 on the other hand has to be checked for at runtime, functions using it need to be marked with AOC_TARGET_AVX2
+#if AOC_HAS_SSE2 && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+    #define AOC_HAS_AVX2_DISPATCH 1
+    
+    #include <immintrin.h>
+    
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        
+        #define AOC_TARGET_AVX2
+    #else
+        #define AOC_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define AOC_HAS_AVX2_DISPATCH 0
+    #define AOC_TARGET_AVX2
+#endif
+
+
+
+namespace aoc
+{
+    /** Determines whether the cpu (and the os) we are running on supports AVX2. */
+    [[nodiscard]]
+    inline bool cpuSupportsAvx2() noexcept
+    {
+    #if AOC_HAS_AVX2_DISPATCH && defined(_MSC_VER) && !defined(__clang__)
+        int info[4] {};
+        __cpuid(info, 0);
+        
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        
+        __cpuid(info, 1);
+        
+        // The os has to save the ymm registers for us
+        if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+        
+        __cpuidex(info, 7, 0);
+        return ((info[1] & (1 << 5)) != 0);
+    #elif AOC_HAS_AVX2_DISPATCH
+        return (__builtin_cpu_supports("avx2") != 0);
+    #else
+        return false;
+    #endif
+    }
+    
+    //==================================================================================================================
+    // Calls "callback(lineBegin, lineEnd)" for every line in the given buffer, the newline is not part of the line.
+    // Newlines are searched for 16 bytes at a time, the last line doesn't need a terminating newline.
+    template<class Fn>
+    void forEachLine(const char *begin, const char *end, Fn &&callback)
+    {
+        const char *line_start = begin;
+        const char *pos        = begin;
+        
+    #if AOC_HAS_SSE2
+        const __m128i newline = _mm_set1_epi8('\n');
+        
+        for (; (end - pos) >= 16; pos += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)); // NOLINT
+            auto          mask  = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+            
+            for (; mask != 0; mask &= (mask - 1))
+            {
+                const char *line_end = pos + aoc::countTrailingZeros(mask);
+                callback(line_start, line_end);
+                line_start = line_end + 1;
+            }
+        }
+    #endif
+        
+        for (; pos != end; ++pos)
+        {
+            if (*pos == '\n')
+            {
+                callback(line_start, pos);
+                line_start = pos + 1;
+            }
+        }
+        
+        if (line_start != end)
+        {
+            callback(line_start, end);
+        }
+    }
+}
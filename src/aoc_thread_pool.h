@@ -0,0 +1,302 @@
+/**
+    ====================================================================================================================
+    
+    This work is free. You can redistribute it and/or modify it under the
+    terms of the Do What The Fuck You Want To Public License, Version 2,
+    as published by Sam Hocevar. See the COPYING file or http://www.wtfpl.net/ 
+    for more details.
+    
+    ====================================================================================================================
+    
+    @author Elanda
+    @file   aoc_thread_pool.h
+    @date   07, December 2022
+    
+    ====================================================================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+
+namespace aoc
+{
+    // A plain pool of worker threads sharing one task queue
+    class ThreadPool
+    {
+    public:
+        /** Creates a pool with the given amount of workers, 0 means one per hardware thread. */
+        explicit ThreadPool(std::size_t threadCount = 0)
+        {
+            if (threadCount == 0)
+            {
+                threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            
+            workers.reserve(threadCount);
+            
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                workers.emplace_back([this]() { work(); });
+            }
+        }
+        
+        ~ThreadPool()
+        {
+            {
+                const std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            
+            condition.notify_all();
+            
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+        }
+        
+        ThreadPool(const ThreadPool&)            = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        
+        //==============================================================================================================
+        /** Queues a task, the returned future holds its result once it's done. */
+        template<class Fn>
+        [[nodiscard]]
+        std::future<std::invoke_result_t<Fn>> submit(Fn &&task)
+        {
+            using Result = std::invoke_result_t<Fn>;
+            
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(task));
+            std::future<Result> result = packaged->get_future();
+            
+            {
+                const std::lock_guard lock(mutex);
+                tasks.emplace([packaged]() { (*packaged)(); });
+            }
+            
+            condition.notify_one();
+            return result;
+        }
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        std::size_t size() const noexcept
+        {
+            return workers.size();
+        }
+        
+    private:
+        std::vector<std::thread>          workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex                        mutex;
+        std::condition_variable           condition;
+        bool                              stopping { false };
+        
+        //==============================================================================================================
+        void work()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                
+                {
+                    std::unique_lock lock(mutex);
+                    condition.wait(lock, [this]() { return (stopping || !tasks.empty()); });
+                    
+                    if (tasks.empty())
+                    {
+                        return;
+                    }
+                    
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                
+                task();
+            }
+        }
+    };
+    
+    //==================================================================================================================
+    // A pool where every worker has its own task deque. A worker runs its newest task first and only once it runs dry
+    // steals the oldest task of another worker, so tasks spawned by other tasks mostly stay on the same thread.
+    class WorkStealingPool
+    {
+    public:
+        /** Creates a pool with the given amount of workers, 0 means one per hardware thread. */
+        explicit WorkStealingPool(std::size_t threadCount = 0)
+        {
+            if (threadCount == 0)
+            {
+                threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            
+            queues .reserve(threadCount);
+            workers.reserve(threadCount);
+            
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                queues.push_back(std::make_unique<Queue>());
+            }
+            
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                workers.emplace_back([this, i]() { work(i); });
+            }
+        }
+        
+        ~WorkStealingPool()
+        {
+            {
+                const std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            
+            condition.notify_all();
+            
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+        }
+        
+        WorkStealingPool(const WorkStealingPool&)            = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+        
+        //==============================================================================================================
+        /** Queues a task, from inside a task it goes onto the deque of the worker running it. */
+        void submit(std::function<void()> task)
+        {
+            const Worker      &worker = currentWorker();
+            const std::size_t index   = (worker.pool == this ? worker.index
+                                                             : (nextQueue.fetch_add(1, std::memory_order_relaxed)
+                                                                % queues.size()));
+            
+            {
+                Queue &queue = *queues[index];
+                const std::lock_guard lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+            }
+            
+            (void) pending.fetch_add(1, std::memory_order_release);
+            
+            {
+                // Makes sure a worker that just found nothing to do is already waiting before it gets notified
+                const std::lock_guard lock(mutex);
+            }
+            
+            condition.notify_one();
+        }
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        std::size_t size() const noexcept
+        {
+            return workers.size();
+        }
+        
+    private:
+        struct Queue
+        {
+            std::mutex                        mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+        
+        struct Worker
+        {
+            WorkStealingPool *pool { nullptr };
+            std::size_t      index { 0 };
+        };
+        
+        //==============================================================================================================
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread>            workers;
+        std::mutex                          mutex;
+        std::condition_variable             condition;
+        std::atomic<std::size_t>            pending   { 0 };
+        std::atomic<std::size_t>            nextQueue { 0 };
+        bool                                stopping  { false };
+        
+        //==============================================================================================================
+        // The pool and deque of the worker running on this thread, if any
+        [[nodiscard]]
+        static Worker& currentWorker() noexcept
+        {
+            thread_local Worker worker;
+            return worker;
+        }
+        
+        [[nodiscard]]
+        std::optional<std::function<void()>> take(std::size_t index)
+        {
+            for (std::size_t i = 0; i < queues.size(); ++i)
+            {
+                Queue &queue = *queues[(index + i) % queues.size()];
+                const std::lock_guard lock(queue.mutex);
+                
+                if (!queue.tasks.empty())
+                {
+                    std::function<void()> task;
+                    
+                    if (i == 0)
+                    {
+                        task = std::move(queue.tasks.back());
+                        queue.tasks.pop_back();
+                    }
+                    else
+                    {
+                        task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                    }
+                    
+                    return task;
+                }
+            }
+            
+            return std::nullopt;
+        }
+        
+        void work(std::size_t index)
+        {
+            currentWorker() = { this, index };
+            
+            while (true)
+            {
+                if (std::optional<std::function<void()>> task = take(index))
+                {
+                    (void) pending.fetch_sub(1, std::memory_order_acq_rel);
+                    (*task)();
+                    continue;
+                }
+                
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [this]()
+                {
+                    return (stopping || pending.load(std::memory_order_acquire) > 0);
+                });
+                
+                if (stopping && pending.load(std::memory_order_acquire) == 0)
+                {
+                    return;
+                }
+            }
+        }
+    };
+}
@@ -17,8 +17,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string_view>
 #include <type_traits>
+#include <vector>
 
 
 
@@ -107,4 +111,59 @@ namespace aoc
         
         return 0;
     }
+    
+    [[nodiscard]]
+    constexpr int countTrailingZeros(std::uint64_t value) noexcept
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return (value == 0 ? 64 : __builtin_ctzll(value));
+    #else
+        int count = 0;
+        
+        for (; count < 64 && (value & 1) == 0; ++count)
+        {
+            value >>= 1;
+        }
+        
+        return count;
+    #endif
+    }
+    
+    [[nodiscard]]
+    constexpr int popCount(std::uint64_t value) noexcept
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(value);
+    #else
+        int count = 0;
+        
+        for (; value != 0; value &= (value - 1))
+        {
+            ++count;
+        }
+        
+        return count;
+    #endif
+    }
+    
+    // Cuts a buffer into the given amount of parts of about the same size, every border is moved just behind the next
+    // newline so that no line is split between two parts. Returns (parts + 1) borders, some parts may be empty
+    [[nodiscard]]
+    inline std::vector<const char*> splitAtLines(const char *begin, const char *end, std::size_t parts)
+    {
+        const auto size = static_cast<std::size_t>(end - begin);
+        
+        std::vector<const char*> borders { begin };
+        borders.reserve(parts + 1);
+        
+        for (std::size_t i = 1; i < parts; ++i)
+        {
+            const char *border = std::max(begin + (size * i / parts), borders.back());
+            const void *next   = std::memchr(border, '\n', static_cast<std::size_t>(end - border));
+            borders.push_back(next != nullptr ? static_cast<const char*>(next) + 1 : end);
+        }
+        
+        borders.push_back(end);
+        return borders;
+    }
 }
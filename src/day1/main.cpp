@@ -15,17 +15,26 @@
     ====================================================================================================================
  */
 
+#include "../aoc_mapped_file.h"
+#include "../aoc_simd.h"
+#include "../aoc_utility.h"
+
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
-#include <queue>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
 
 //**********************************************************************************************************************
-// region main
+// region Namespace
 //======================================================================================================================
-int main()
+namespace
 {
     //==================================================================================================================
     struct ElfScore
@@ -42,40 +51,353 @@ int main()
     };
     
     //==================================================================================================================
-    std::ifstream file(INPUT_FILE); // File url defined in CMake script
+    // Our ranking, the higher the score the better; on a draw the elf that came in first wins
+    [[nodiscard]]
+    constexpr bool ranksHigher(const ElfScore &left, const ElfScore &right) noexcept
+    {
+        return (left.score > right.score || (left.score == right.score && left.number < right.number));
+    }
     
-    if (!file.is_open())
+    //==================================================================================================================
+    // Keeps track of the K best elves while the input is being read.
+    // Internally this is a min-heap of at most K elements, so memory is bound by K and not by the amount of elves
+    class TopKSelector
     {
-        std::cout << "Couldn't open input";
-        return 1;
+    public:
+        explicit TopKSelector(std::size_t parK)
+            : k(parK)
+        {
+            heap.reserve(k);
+        }
+        
+        //==============================================================================================================
+        /** Offers a new elf to the selector, it will only be kept if it is among the best K elves so far. */
+        void offer(const ElfScore &elf)
+        {
+            if (heap.size() < k)
+            {
+                heap.push_back(elf);
+                std::push_heap(heap.begin(), heap.end(), ranksHigher);
+            }
+            else if (k > 0 && ranksHigher(elf, heap.front()))
+            {
+                std::pop_heap(heap.begin(), heap.end(), ranksHigher);
+                heap.back() = elf;
+                std::push_heap(heap.begin(), heap.end(), ranksHigher);
+            }
+        }
+        
+        //==============================================================================================================
+        /** Gets the best elves, starting with the big boss. */
+        [[nodiscard]]
+        std::vector<ElfScore> getRanking() const
+        {
+            std::vector<ElfScore> ranking = heap;
+            std::sort(ranking.begin(), ranking.end(), ranksHigher);
+            return ranking;
+        }
+        
+    private:
+        std::vector<ElfScore> heap;
+        std::size_t           k;
+    };
+    
+    //==================================================================================================================
+    [[nodiscard]]
+    int parseCalories(const char *begin, const char *end) noexcept
+    {
+        int calories = 0;
+        
+        for (; begin != end && aoc::isDigit(*begin); ++begin)
+        {
+            calories = (calories * 10) + (*begin - '0');
+        }
+        
+        return calories;
+    }
+    
+    // Sums up the calories of raw input lines, a group only counts once a blank line follows it (like the getline loop)
+    class GroupAccumulator
+    {
+    public:
+        explicit GroupAccumulator(TopKSelector &parSelector) noexcept
+            : selector(parSelector)
+        {}
+        
+        //==============================================================================================================
+        void addLine(const char *begin, const char *end)
+        {
+            if (begin != end && *(end - 1) == '\r')
+            {
+                (void) --end;
+            }
+            
+            if (begin != end)
+            {
+                score += parseCalories(begin, end);
+            }
+            else if (score > 0)
+            {
+                selector.offer({ std::exchange(score, 0), number++ });
+            }
+        }
+        
+    private:
+        TopKSelector &selector;
+        int          score  { 0 };
+        int          number { 1 };
+    };
+    
+    //==================================================================================================================
+    // What a worker found in its byte range.
+    // Groups reaching over the range's borders can't be decided locally, so the worker only reports the calories before
+    // its first and after its last blank line; everything in between is numbered relative to the chunk.
+    struct ChunkSummary
+    {
+        //==============================================================================================================
+        TopKSelector selector;
+        int          head         { 0 };
+        int          tail         { 0 };
+        int          groupCount   { 0 };
+        bool         hasSeparator { false };
+        
+        //==============================================================================================================
+        explicit ChunkSummary(std::size_t k)
+            : selector(k)
+        {}
+    };
+    
+    void summariseChunk(const char *begin, const char *end, ChunkSummary &summary)
+    {
+        int score = 0;
+        
+        aoc::forEachLine(begin, end, [&summary, &score](const char *lineBegin, const char *lineEnd)
+        {
+            if (lineBegin != lineEnd && *(lineEnd - 1) == '\r')
+            {
+                (void) --lineEnd;
+            }
+            
+            if (lineBegin != lineEnd)
+            {
+                score += parseCalories(lineBegin, lineEnd);
+            }
+            else if (!summary.hasSeparator)
+            {
+                // The first group might have started in one of the previous chunks
+                summary.head         = std::exchange(score, 0);
+                summary.hasSeparator = true;
+            }
+            else if (score > 0)
+            {
+                summary.selector.offer({ std::exchange(score, 0), summary.groupCount++ });
+            }
+        });
+        
+        if (summary.hasSeparator)
+        {
+            summary.tail = score;
+        }
+        else
+        {
+            summary.head = score;
+        }
+    }
+    
+    //==================================================================================================================
+    [[nodiscard]]
+    bool readStreamed(const char *inputUrl, TopKSelector &selector)
+    {
+        std::ifstream file(inputUrl);
+        
+        if (!file.is_open())
+        {
+            return false;
+        }
+        
+        std::string line;
+        int         score = 0;
+        
+        for (int i = 1; std::getline(file, line);)
+        {
+            if (!line.empty())
+            {
+                score += std::stoi(line);
+            }
+            else if (score > 0)
+            {
+                selector.offer({ std::exchange(score, 0), i++ });
+            }
+        }
+        
+        return true;
     }
     
-    static constexpr auto comparator = [](auto &&left, auto &&right) { return (left.score < right.score); };
-    std::priority_queue<ElfScore, std::vector<ElfScore>, decltype(comparator)> p_queue(comparator);
+    [[nodiscard]]
+    bool readMapped(const char *inputUrl, TopKSelector &selector)
+    {
+        try
+        {
+            const aoc::MappedFile file(inputUrl);
+            GroupAccumulator      accumulator(selector);
+            
+            aoc::forEachLine(file.begin(), file.end(), [&accumulator](const char *begin, const char *end)
+            {
+                accumulator.addLine(begin, end);
+            });
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        
+        return true;
+    }
     
-    std::string line;
-    int         score = 0;
+    [[nodiscard]]
+    bool readParallel(const char *inputUrl, TopKSelector &selector, std::size_t threadCount, std::size_t k)
+    {
+        try
+        {
+            const aoc::MappedFile file(inputUrl);
+            
+            // No line is split between two workers, but groups still can be
+            const std::vector<const char*> borders = aoc::splitAtLines(file.begin(), file.end(), threadCount);
+            
+            std::vector<ChunkSummary> summaries(threadCount, ChunkSummary(k));
+            std::vector<std::thread>  workers;
+            workers.reserve(threadCount);
+            
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                workers.emplace_back(summariseChunk, borders[i], borders[i + 1], std::ref(summaries[i]));
+            }
+            
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+            
+            // Stitch the groups at the borders and renumber every chunk's elves by the amount of elves before it
+            int carry  = 0;
+            int number = 1;
+            
+            for (const ChunkSummary &summary : summaries)
+            {
+                if (!summary.hasSeparator)
+                {
+                    carry += summary.head;
+                    continue;
+                }
+                
+                if (const int score = (carry + summary.head); score > 0)
+                {
+                    selector.offer({ score, number++ });
+                }
+                
+                for (const ElfScore &elf : summary.selector.getRanking())
+                {
+                    selector.offer({ elf.score, number + elf.number });
+                }
+                
+                number += summary.groupCount;
+                carry   = summary.tail;
+            }
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        
+        return true;
+    }
+}
+//======================================================================================================================
+// endregion Namespace
+//**********************************************************************************************************************
+// region main
+//======================================================================================================================
+int main(int argc, char **argv)
+{
+    // Usage: day_1 [--top K] [--mmap] [--threads N] [input file]
+    std::size_t top_k        = 3;
+    std::size_t thread_count = 1;
+    bool        use_mmap     = false;
+    const char  *input_url   = INPUT_FILE; // File url defined in CMake script
     
-    for (int i = 1; std::getline(file, line);)
+    for (int i = 1; i < argc; ++i)
     {
-        if (!line.empty())
+        const std::string_view arg(argv[i]);
+        
+        if (arg == "--top" && (i + 1) < argc)
+        {
+            top_k = std::max<std::size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+        }
+        else if (arg == "--threads" && (i + 1) < argc)
+        {
+            thread_count = std::strtoul(argv[++i], nullptr, 10);
+            
+            if (thread_count == 0)
+            {
+                thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+        }
+        else if (arg == "--mmap")
         {
-            score += std::stoi(line);
+            use_mmap = true;
         }
-        else if (score > 0)
+        else
         {
-            p_queue.emplace(std::exchange(score, 0), i++);
+            input_url = argv[i];
         }
     }
     
-    const ElfScore top1 = p_queue.top();
-    p_queue.pop();
+    //==================================================================================================================
+    TopKSelector selector(top_k);
+    
+    bool success;
+    
+    if (thread_count > 1)
+    {
+        success = ::readParallel(input_url, selector, thread_count, top_k);
+    }
+    else
+    {
+        success = (use_mmap ? ::readMapped(input_url, selector) : ::readStreamed(input_url, selector));
+    }
+    
+    if (!success)
+    {
+        std::cout << "Couldn't open input";
+        return 1;
+    }
+    
+    const std::vector<ElfScore> ranking = selector.getRanking();
+    
+    if (ranking.empty())
+    {
+        std::cout << "Not a single elf brought anything";
+        return 1;
+    }
+    
+    const ElfScore &top1 = ranking.front();
     std::cout << "Elf numero " << top1.number << " is the big boss with " << top1.score << " calories!\n";
     
-    const ElfScore top2 = p_queue.top();
-    p_queue.pop();
-    const ElfScore top3 = p_queue.top();
-    std::cout << "Top three elves carry in sum: " << (top1.score + top2.score + top3.score);
+    long long sum = 0;
+    
+    for (const ElfScore &elf : ranking)
+    {
+        sum += elf.score;
+    }
+    
+    if (top_k == 3)
+    {
+        std::cout << "Top three elves carry in sum: " << sum;
+    }
+    else
+    {
+        std::cout << "Top " << ranking.size() << " elves carry in sum: " << sum;
+    }
     
     return 0;
 }
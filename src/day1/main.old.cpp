@@ -15,10 +15,20 @@
     ====================================================================================================================
  */
 
+#include "../aoc_mapped_file.h"
+#include "../aoc_simd.h"
+#include "../aoc_utility.h"
+
+#include <algorithm>
 #include <array>
+#include <charconv>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <random>
-#include <regex>
+#include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -54,23 +64,64 @@ namespace
     };
     
     //==================================================================================================================
+    // All phrases with all elf names filled in, so we only have to do this once and not for every greeting
     [[nodiscard]]
-    std::string getMessage(size_t phraseId, std::size_t elfId)
+    std::vector<std::string> expandPhrases()
     {
-        const std::regex pattern(R"(\{\})");
-        std::string      output (introductionPhrases[phraseId]);
-        std::smatch      match;
+        std::vector<std::string> messages;
+        messages.reserve(introductionPhrases.size() * elves.size());
         
-        while (std::regex_search(output, match, pattern))
+        for (const std::string_view phrase : introductionPhrases)
         {
-            output = match.prefix().str() + std::string(elves[elfId]) + match.suffix().str();
+            for (const std::string_view elf : elves)
+            {
+                std::string &output = messages.emplace_back(phrase);
+                
+                for (std::size_t pos; (pos = output.find("{}")) != std::string::npos;)
+                {
+                    (void) output.replace(pos, 2, elf);
+                }
+            }
         }
         
-        return output;
+        return messages;
     }
     
     [[nodiscard]]
-    std::vector<int> createIndices()
+    const std::string& getMessage(size_t phraseId, std::size_t elfId)
+    {
+        static const std::vector<std::string> messages = expandPhrases();
+        return messages[(phraseId * elves.size()) + elfId];
+    }
+    
+    //==================================================================================================================
+    // Behaves like std::stoi but reports invalid numbers and numbers that are too big by returning nothing
+    [[nodiscard]]
+    std::optional<int> parseCalories(std::string_view input) noexcept
+    {
+        while (!input.empty() && aoc::isWhitespace(input.front()))
+        {
+            input.remove_prefix(1);
+        }
+        
+        if (!input.empty() && input.front() == '+')
+        {
+            input.remove_prefix(1);
+        }
+        
+        int value = 0;
+        
+        if (const auto [ptr, error] = std::from_chars(input.data(), input.data() + input.size(), value);
+            error != std::errc{})
+        {
+            return std::nullopt;
+        }
+        
+        return value;
+    }
+    
+    [[nodiscard]]
+    std::vector<int> createIndices(std::mt19937 &g)
     {
         std::vector<int> result;
         std::generate_n(std::back_inserter(result), introductionPhrases.size(),
@@ -79,13 +130,142 @@ namespace
                             return counter++;
                         });
         
-        std::random_device rd;
-        std::mt19937       g(rd());
         std::shuffle(result.begin(), result.end(), g);
         
         result.resize(elves.size());
         return result;
     }
+    
+    [[nodiscard]]
+    std::vector<int> createIndices()
+    {
+        std::random_device rd;
+        std::mt19937       g(rd());
+        return createIndices(g);
+    }
+    
+    //==================================================================================================================
+    struct ElfScore // NOLINT
+    {
+        std::size_t index;
+        int         calories { -1 };
+    };
+    
+    //==================================================================================================================
+    // Replays a whole recorded transcript at once, that is the same lines one would enter in the interactive dialogue.
+    // A transcript can contain any number of sessions, a new one starts after every elf had their turn.
+    [[nodiscard]]
+    int runBatch(std::string_view transcriptUrl)
+    {
+        std::string                    piped;
+        std::optional<aoc::MappedFile> file;
+        std::string_view               transcript;
+        
+        if (transcriptUrl == "-")
+        {
+            piped.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+            transcript = piped;
+        }
+        else
+        {
+            try
+            {
+                transcript = file.emplace(std::string(transcriptUrl)).view();
+            }
+            catch (const std::exception &ex)
+            {
+                std::cout << "Couldn't open transcript: " << ex.what() << '\n';
+                return 1;
+            }
+        }
+        
+        std::random_device rd;
+        std::mt19937       g(rd());
+        std::vector<int>   indices = createIndices(g);
+        
+        ElfScore    highscore;
+        std::size_t session       = 1;
+        std::size_t elf           = 0;
+        std::size_t line_number   = 0;
+        int         calorie_count = 0;
+        bool        greeted       = false;
+        
+        const auto finish_elf = [&]()
+        {
+            if (calorie_count > highscore.calories)
+            {
+                highscore = { elf, calorie_count };
+            }
+            
+            calorie_count = 0;
+            greeted       = false;
+            
+            if (++elf == elves.size())
+            {
+                std::cout << "Session " << session++ << ": " << elves[highscore.index] << " has done well with "
+                          << highscore.calories << " calories.\n";
+                
+                highscore = {};
+                elf       = 0;
+                std::shuffle(indices.begin(), indices.end(), g);
+            }
+        };
+        
+        aoc::forEachLine(transcript.data(), transcript.data() + transcript.size(),
+                         [&](const char *begin, const char *end)
+                         {
+                             (void) ++line_number;
+                             
+                             if (!greeted)
+                             {
+                                 std::cout << getMessage(indices[elf], elf) << '\n';
+                                 greeted = true;
+                             }
+                             
+                             if (begin != end && *(end - 1) == '\r')
+                             {
+                                 (void) --end;
+                             }
+                             
+                             if (begin == end)
+                             {
+                                 finish_elf();
+                                 return;
+                             }
+                             
+                             const std::optional<int> input_calories = parseCalories({ begin,
+                                 static_cast<std::size_t>(end - begin) });
+                             
+                             if (!input_calories.has_value())
+                             {
+                                 std::cout << "Line " << line_number << ": not a valid calorie or too high, ignored\n";
+                                 return;
+                             }
+                             
+                             if ((static_cast<std::size_t>(calorie_count) + *input_calories)
+                                     > std::numeric_limits<int>::max())
+                             {
+                                 std::cout << "Line " << line_number << ": that is bit too much calories, ignored\n";
+                                 return;
+                             }
+                             
+                             calorie_count += *input_calories;
+                         });
+        
+        // A transcript that doesn't end with an empty line still has its last elf reporting
+        if (greeted)
+        {
+            finish_elf();
+        }
+        
+        if (elf > 0)
+        {
+            std::cout << "Session " << session << " ended early, only " << elf << " elves reported back.\n";
+        }
+        
+        std::cout << std::flush;
+        return 0;
+    }
 }
 //======================================================================================================================
 // endregion Namespace
@@ -96,11 +276,12 @@ int main(int argc, char **argv)
 {
     using ElfInventory = std::vector<int>;
     
-    struct ElfScore // NOLINT
+    // Usage: day_1_old [--batch <transcript file or - for stdin>]
+    if (argc > 1 && std::string_view(argv[1]) == "--batch")
     {
-        std::size_t index;
-        int         calories { -1 };
-    };
+        std::ios::sync_with_stdio(false);
+        return ::runBatch(argc > 2 ? argv[2] : "-");
+    }
     
     std::cout << "Ho ho ho, happy early christmas my dear underlings, namely, elves.\n"
                  "Unfortunately, before we can engage in distributing kids toys, we need to fill up our stamina with "
@@ -121,7 +302,7 @@ int main(int argc, char **argv)
     for (auto it = ::elves.begin(); it != elves.end(); ++it)
     {
         const std::size_t index  = std::distance(elves.begin(), it);
-        const std::string phrase = ::getMessage(indices[index], index);
+        const std::string &phrase = ::getMessage(indices[index], index);
         
         std::cout << phrase << '\n'
                   << "(Enter calorie numbers line by line, you can have as many as you want. "
@@ -139,23 +320,21 @@ int main(int argc, char **argv)
                 break;
             }
             
-            try
+            const std::optional<int> input_calories = ::parseCalories(input);
+            
+            if (!input_calories.has_value())
             {
-                const int input_calories = std::stoi(input);
-                
-                if ((static_cast<std::size_t>(calorie_count) + input_calories) > std::numeric_limits<int>::max())
-                {
-                    std::cout << "Uiuiui, that is bit too much calories, let's ignore this item - go on!\n" << std::flush;
-                    continue;
-                }
-                
-                calorie_count += input_calories;
+                std::cout << "Not a valid calorie or too high, try again:\n" << std::flush;
+                continue;
             }
-            catch (const std::exception &ex)
+            
+            if ((static_cast<std::size_t>(calorie_count) + *input_calories) > std::numeric_limits<int>::max())
             {
-                std::cout << "Not a valid calorie or too high, try again:\n" << std::flush;
+                std::cout << "Uiuiui, that is bit too much calories, let's ignore this item - go on!\n" << std::flush;
                 continue;
             }
+            
+            calorie_count += *input_calories;
         }
         
         if (calorie_count > highscore.calories)
@@ -15,10 +15,21 @@
     ====================================================================================================================
  */
 
+#include "../aoc_mapped_file.h"
+#include "../aoc_simd.h"
+
+#include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 
 
@@ -88,46 +99,499 @@ namespace
         const int factor = ::modulo(((figureOpponent % 3) - figureMe), 3) + 1;
         return 3 * (factor % 3);
     }
+    
+    //==================================================================================================================
+    // The final points of both readings of the strategy guide
+    struct Scores
+    {
+        long long opponentPoints       { 0 };
+        long long myPoints             { 0 };
+        long long opponentActualPoints { 0 };
+        long long myActualPoints       { 0 };
+        
+        //==============================================================================================================
+        constexpr Scores& operator+=(const Scores &other) noexcept
+        {
+            opponentPoints       += other.opponentPoints;
+            myPoints             += other.myPoints;
+            opponentActualPoints += other.opponentActualPoints;
+            myActualPoints       += other.myActualPoints;
+            return *this;
+        }
+        
+        [[nodiscard]]
+        constexpr bool operator==(const Scores &other) const noexcept
+        {
+            return (opponentPoints       == other.opponentPoints
+                 && myPoints             == other.myPoints
+                 && opponentActualPoints == other.opponentActualPoints
+                 && myActualPoints       == other.myActualPoints);
+        }
+    };
+    
+    [[nodiscard]]
+    Scores scoreReference(const char *inputUrl)
+    {
+        std::fstream file(inputUrl);
+        std::string  input;
+        Scores       scores;
+        
+        while (std::getline(file, input))
+        {
+            const ::Round round = ::Round::fromInput(input);
+            
+            // The drama of guessing what a column means
+            const int result = ::calculateResult(round.opponent, round.me);
+            scores.opponentPoints += (round.opponent + result);
+            scores.myPoints       += (round.me       + (6 - result));
+            
+            // The drama of then actually hearing what it really is about
+            const int needed_fig = strategies[round.me - 1](round.opponent);
+            const int result_2   = ::calculateResult(round.opponent, needed_fig);
+            
+            scores.opponentActualPoints += (round.opponent + result_2);
+            scores.myActualPoints       += (needed_fig     + (6 - result_2));
+        }
+        
+        return scores;
+    }
+    
+    //==================================================================================================================
+    // There are only 9 different rounds, so we can precalculate every score there is;
+    // a round's index is "(opponent - 1) * 3 + (me - 1)"
+    constexpr int roundCount = 9;
+    
+    struct RoundScore
+    {
+        int opponent;
+        int me;
+        int opponentActual;
+        int meActual;
+    };
+    
+    constexpr std::array<RoundScore, roundCount> scoreTable = []()
+    {
+        std::array<RoundScore, roundCount> table {};
+        
+        for (int opponent = 1; opponent <= 3; ++opponent)
+        {
+            for (int me = 1; me <= 3; ++me)
+            {
+                const int result     = ::calculateResult(opponent, me);
+                const int needed_fig = strategies[me - 1](opponent);
+                const int result_2   = ::calculateResult(opponent, needed_fig);
+                
+                table[((opponent - 1) * 3) + (me - 1)] = {
+                    opponent + result,
+                    me + (6 - result),
+                    opponent + result_2,
+                    needed_fig + (6 - result_2)
+                };
+            }
+        }
+        
+        return table;
+    }();
+    
+    /** How often every one of the 9 rounds was played. */
+    using RoundHistogram = std::array<std::uint64_t, roundCount>;
+    
+    [[nodiscard]]
+    constexpr Scores scoreHistogram(const RoundHistogram &histogram) noexcept
+    {
+        Scores scores;
+        
+        for (int i = 0; i < roundCount; ++i)
+        {
+            const auto count = static_cast<long long>(histogram[i]);
+            
+            scores.opponentPoints       += count * scoreTable[i].opponent;
+            scores.myPoints             += count * scoreTable[i].me;
+            scores.opponentActualPoints += count * scoreTable[i].opponentActual;
+            scores.myActualPoints       += count * scoreTable[i].meActual;
+        }
+        
+        return scores;
+    }
+    
+    //==================================================================================================================
+    // Every line is exactly "A X\n", so the input is nothing but an array of 4-byte records
+    constexpr std::size_t recordSize = 4;
+    
+#if AOC_HAS_SSE2
+    [[nodiscard]]
+    std::uint32_t recordKey(int index) noexcept
+    {
+        const std::array<char, recordSize> record {
+            static_cast<char>('A' + (index / 3)), ' ', static_cast<char>('X' + (index % 3)), '\n'
+        };
+        
+        std::uint32_t key;
+        (void) std::memcpy(&key, record.data(), recordSize);
+        return key;
+    }
+#endif
+    
+    // Tallies a single "A X\n" record, returns false if it isn't one of the 9 rounds
+    [[nodiscard]]
+    inline bool tallyRecord(const char *record, RoundHistogram &histogram) noexcept
+    {
+        const auto opponent = static_cast<unsigned>(record[offsetOpponent] - 'A');
+        const auto me       = static_cast<unsigned>(record[offsetMe]       - 'X');
+        
+        if (opponent > 2 || me > 2)
+        {
+            return false;
+        }
+        
+        (void) ++histogram[(opponent * 3) + me];
+        return true;
+    }
+    
+    // The plain version, one increment per round
+    [[nodiscard]]
+    bool tallyRecords(const char *begin, const char *end, RoundHistogram &histogram) noexcept
+    {
+        for (; static_cast<std::size_t>(end - begin) >= recordSize; begin += recordSize)
+        {
+            if (begin[recordSize - 1] != '\n' || !tallyRecord(begin, histogram))
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    // Counts the records of a buffer made up of whole "A X\n" records.
+    // SSE2 has no byte shuffles to do the table lookup in a register, so instead each record lane is compared against
+    // all 9 possible records and every match is added to a per-round lane counter; the table is applied at the very end.
+    // Returns false if a record didn't match any of the 9 rounds.
+    [[nodiscard]]
+    bool countRecords(const char *begin, const char *end, RoundHistogram &histogram) noexcept
+    {
+        const char *pos = begin;
+        
+    #if AOC_HAS_SSE2
+        // 16 rounds per iteration, each 32-bit lane counter gains at most 4 per iteration, so flushing them after
+        // 2^30 - 1 iterations keeps them at or below 2^32 - 4
+        constexpr std::size_t blockSize     = 64;
+        constexpr std::size_t flushInterval = (1u << 30) - 1;
+        
+        __m128i       key_vectors[roundCount]; // NOLINT
+        std::uint64_t matched = 0;
+        
+        for (int i = 0; i < roundCount; ++i)
+        {
+            key_vectors[i] = _mm_set1_epi32(static_cast<int>(recordKey(i)));
+        }
+        
+        const std::size_t vector_records = (static_cast<std::size_t>(end - pos) / blockSize) * (blockSize / recordSize);
+        
+        while (static_cast<std::size_t>(end - pos) >= blockSize)
+        {
+            __m128i counters[roundCount]; // NOLINT
+            
+            for (__m128i &counter : counters)
+            {
+                counter = _mm_setzero_si128();
+            }
+            
+            for (std::size_t n = 0; n < flushInterval && static_cast<std::size_t>(end - pos) >= blockSize; ++n)
+            {
+                const __m128i *block = reinterpret_cast<const __m128i*>(pos); // NOLINT
+                const __m128i  r0    = _mm_loadu_si128(block);
+                const __m128i  r1    = _mm_loadu_si128(block + 1);
+                const __m128i  r2    = _mm_loadu_si128(block + 2);
+                const __m128i  r3    = _mm_loadu_si128(block + 3);
+                
+                for (int i = 0; i < roundCount; ++i)
+                {
+                    // A match is all bits set, which is -1, so subtracting it counts up
+                    const __m128i hits = _mm_add_epi32(_mm_add_epi32(_mm_cmpeq_epi32(r0, key_vectors[i]),
+                                                                     _mm_cmpeq_epi32(r1, key_vectors[i])),
+                                                       _mm_add_epi32(_mm_cmpeq_epi32(r2, key_vectors[i]),
+                                                                     _mm_cmpeq_epi32(r3, key_vectors[i])));
+                    counters[i] = _mm_sub_epi32(counters[i], hits);
+                }
+                
+                pos += blockSize;
+            }
+            
+            for (int i = 0; i < roundCount; ++i)
+            {
+                std::array<std::uint32_t, 4> lanes {};
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.data()), counters[i]); // NOLINT
+                
+                const std::uint64_t count = std::uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+                histogram[i] += count;
+                matched      += count;
+            }
+        }
+        
+        if (matched != vector_records)
+        {
+            return false;
+        }
+    #endif
+        
+        return tallyRecords(pos, end, histogram);
+    }
+    
+    // Gets the end of the whole records of a mapped input, a last line without newline will be tallied right away.
+    // Returns nullptr if the input isn't made of "A X" records.
+    [[nodiscard]]
+    const char* findRecordsEnd(const aoc::MappedFile &file, RoundHistogram &histogram) noexcept
+    {
+        if (file.size() % recordSize == (recordSize - 1))
+        {
+            const char *end = file.end() - (recordSize - 1);
+            return (tallyRecord(end, histogram) ? end : nullptr);
+        }
+        
+        return (file.size() % recordSize == 0 ? file.end() : nullptr);
+    }
+    
+    // Builds the histogram of a whole input file, either with the vectorised or the plain counter
+    [[nodiscard]]
+    bool loadHistogram(const char *inputUrl, RoundHistogram &histogram, bool vectorised)
+    {
+        try
+        {
+            const aoc::MappedFile file(inputUrl);
+            const char            *end = findRecordsEnd(file, histogram);
+            
+            if (end == nullptr)
+            {
+                return false;
+            }
+            
+            return (vectorised ? countRecords(file.begin(), end, histogram)
+                               : tallyRecords(file.begin(), end, histogram));
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    
+    // Since every record has the same width we can split the input at exact offsets, no need to look for line ends.
+    // Every thread scores its own slice and the totals are summed up at the end.
+    [[nodiscard]]
+    bool scoreParallel(const char *inputUrl, std::size_t threadCount, Scores &scores)
+    {
+        try
+        {
+            const aoc::MappedFile file(inputUrl);
+            RoundHistogram        remainder {};
+            const char            *end = findRecordsEnd(file, remainder);
+            
+            if (end == nullptr)
+            {
+                return false;
+            }
+            
+            const std::size_t records = static_cast<std::size_t>(end - file.begin()) / recordSize;
+            
+            std::vector<Scores>      slice_scores(threadCount);
+            std::vector<char>        slice_valid (threadCount, 0);
+            std::vector<std::thread> workers;
+            workers.reserve(threadCount);
+            
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                const char *slice_begin = file.begin() + ((records * i)       / threadCount) * recordSize;
+                const char *slice_end   = file.begin() + ((records * (i + 1)) / threadCount) * recordSize;
+                
+                workers.emplace_back([slice_begin, slice_end, &result = slice_scores[i], &valid = slice_valid[i]]()
+                {
+                    RoundHistogram histogram {};
+                    valid  = countRecords(slice_begin, slice_end, histogram);
+                    result = scoreHistogram(histogram);
+                });
+            }
+            
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+            
+            scores = scoreHistogram(remainder);
+            
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                if (slice_valid[i] == 0)
+                {
+                    return false;
+                }
+                
+                scores += slice_scores[i];
+            }
+            
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    
+    //==================================================================================================================
+    // Any way of reading the second column, given as the figure I play for every one of the 9 rounds
+    struct Interpretation
+    {
+        //==============================================================================================================
+        std::string_view            name;
+        std::array<int, roundCount> myWeights;
+        std::array<int, roundCount> opponentWeights;
+        
+        //==============================================================================================================
+        template<class FigureFunction>
+        static constexpr Interpretation create(std::string_view name, FigureFunction &&figureOf) noexcept
+        {
+            Interpretation interpretation { name, {}, {} };
+            
+            for (int opponent = 1; opponent <= 3; ++opponent)
+            {
+                for (int column = 1; column <= 3; ++column)
+                {
+                    const int index  = ((opponent - 1) * 3) + (column - 1);
+                    const int figure = figureOf(opponent, column);
+                    const int result = ::calculateResult(opponent, figure);
+                    
+                    interpretation.myWeights      [index] = figure + (6 - result);
+                    interpretation.opponentWeights[index] = opponent + result;
+                }
+            }
+            
+            return interpretation;
+        }
+        
+        //==============================================================================================================
+        /** Gets my and the opponents points, each one is just a 9 element dot product with the histogram. */
+        [[nodiscard]]
+        constexpr std::pair<long long, long long> score(const RoundHistogram &histogram) const noexcept
+        {
+            long long mine     = 0;
+            long long opponent = 0;
+            
+            for (int i = 0; i < roundCount; ++i)
+            {
+                mine     += static_cast<long long>(histogram[i]) * myWeights[i];
+                opponent += static_cast<long long>(histogram[i]) * opponentWeights[i];
+            }
+            
+            return { mine, opponent };
+        }
+    };
+    
+    // The outcome reading plus every possible assignment of X/Y/Z to figures (the first one being the guessed reading)
+    constexpr std::array interpretations {
+        Interpretation::create("X=Rock, Y=Paper, Z=Scissors", [](int, int c) { return std::array{ 1, 2, 3 }[c - 1]; }),
+        Interpretation::create("X=Rock, Y=Scissors, Z=Paper", [](int, int c) { return std::array{ 1, 3, 2 }[c - 1]; }),
+        Interpretation::create("X=Paper, Y=Rock, Z=Scissors", [](int, int c) { return std::array{ 2, 1, 3 }[c - 1]; }),
+        Interpretation::create("X=Paper, Y=Scissors, Z=Rock", [](int, int c) { return std::array{ 2, 3, 1 }[c - 1]; }),
+        Interpretation::create("X=Scissors, Y=Rock, Z=Paper", [](int, int c) { return std::array{ 3, 1, 2 }[c - 1]; }),
+        Interpretation::create("X=Scissors, Y=Paper, Z=Rock", [](int, int c) { return std::array{ 3, 2, 1 }[c - 1]; }),
+        Interpretation::create("X=Lose, Y=Draw, Z=Win", [](int o, int c) { return strategies[c - 1](o); })
+    };
 }
 //======================================================================================================================
 // endregion Namespace
 //**********************************************************************************************************************
 // region Main
 //======================================================================================================================
-int main()
+int main(int argc, char **argv)
 {
-    std::fstream file(INPUT_FILE);
-    std::string  input;
+    // Usage: day_2 [--lut | --histogram | --threads N] [--validate] [input file]
+    std::size_t thread_count  = 1;
+    bool        use_lut       = false;
+    bool        use_histogram = false;
+    bool        validate      = false;
+    const char  *input_url    = INPUT_FILE;
+    
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg(argv[i]);
+        
+        if (arg == "--lut")
+        {
+            use_lut = true;
+        }
+        else if (arg == "--histogram")
+        {
+            use_histogram = true;
+        }
+        else if (arg == "--threads" && (i + 1) < argc)
+        {
+            thread_count = std::strtoul(argv[++i], nullptr, 10);
+            
+            if (thread_count == 0)
+            {
+                thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+        }
+        else if (arg == "--validate")
+        {
+            validate = true;
+        }
+        else
+        {
+            input_url = argv[i];
+        }
+    }
     
-    int opponent_points = 0;
-    int my_points       = 0;
+    ::Scores         scores;
+    ::RoundHistogram histogram {};
     
-    int opponent_actual_points = 0;
-    int my_actual_points       = 0;
+    const bool use_threads = (thread_count > 1 && !use_histogram);
     
-    while (std::getline(file, input))
+    if (use_threads)
     {
-        const ::Round round = ::Round::fromInput(input);
-        
-        // The drama of guessing what a column means
-        const int result = ::calculateResult(round.opponent, round.me);
-        opponent_points += (round.opponent + result);
-        my_points       += (round.me       + (6 - result));
-        
-        // The drama of then actually hearing what it really is about
-        const int needed_fig = strategies[round.me - 1](round.opponent);
+        if (!::scoreParallel(input_url, thread_count, scores))
+        {
+            std::cout << "Input is not made of fixed-width \"A X\" rounds";
+            return 1;
+        }
+    }
+    else if (use_lut || use_histogram)
+    {
+        if (!::loadHistogram(input_url, histogram, use_lut))
+        {
+            std::cout << "Input is not made of fixed-width \"A X\" rounds";
+            return 1;
+        }
         
-        // Would probably be better to cache all possible results inside a lookup table and make a lookup instead
-        // of calculating it everytime again, but... idrc
-        const int result_2 = ::calculateResult(round.opponent, needed_fig);
+        scores = ::scoreHistogram(histogram);
+    }
+    else
+    {
+        scores = ::scoreReference(input_url);
+    }
+    
+    std::cout << "I have won with " << scores.myPoints << " points, hooray! (opponent has: "
+                  << scores.opponentPoints << ")\n";
+    std::cout << "For real though, actually I won with " << scores.myActualPoints
+                  << " points, hooray! (opponent has: "  << scores.opponentActualPoints << ')';
+    
+    if (use_histogram)
+    {
+        std::cout << "\n\nEvery way of reading the second column:\n";
         
-        opponent_actual_points += (round.opponent + result_2);
-        my_actual_points       += (needed_fig     + (6 - result_2));
+        for (const ::Interpretation &interpretation : ::interpretations)
+        {
+            const auto [mine, opponent] = interpretation.score(histogram);
+            std::cout << "    " << std::left << std::setw(30) << interpretation.name
+                      << " me: " << std::setw(12) << mine << " opponent: " << opponent << '\n';
+        }
     }
     
-    std::cout << "I have won with " << my_points << " points, hooray! (opponent has: " << opponent_points << ")\n";
-    std::cout << "For real though, actually I won with " << my_actual_points
-                  << " points, hooray! (opponent has: "  << opponent_actual_points << ')';
+    if (validate && (use_lut || use_histogram || use_threads))
+    {
+        const bool matches = (::scoreReference(input_url) == scores);
+        std::cout << "\nValidation against the reference path " << (matches ? "passed" : "FAILED");
+        return (matches ? 0 : 1);
+    }
     
     return 0;
 }
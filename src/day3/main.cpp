@@ -15,10 +15,26 @@
     ====================================================================================================================
  */
 
+#include "../aoc_mapped_file.h"
+#include "../aoc_simd.h"
+#include "../aoc_thread_pool.h"
+#include "../aoc_utility.h"
+
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <string_view>
+#include <utility>
+#include <vector>
+
+#ifndef AOC_DAY3_COMPILE_TIME
+    #define AOC_DAY3_COMPILE_TIME 1
+#endif
 
 
 
@@ -27,253 +43,634 @@
 //======================================================================================================================
 namespace
 {
+#if AOC_DAY3_COMPILE_TIME
     //==================================================================================================================
     // We include the input as an array
     constexpr std::array input {
         #include "input.txt"
     };
+#endif
+    
+    constexpr std::size_t priorityOffsetLower = ('a' -  1);
+    constexpr std::size_t priorityOffsetUpper = ('A' - 27);
     
-    constexpr std::size_t maxCompartmentSize = []()
+    /** How much further a lowercase item is from its priority than an uppercase one, for the vector kernels. */
+    constexpr char priorityOffsetDelta = static_cast<char>(priorityOffsetLower - priorityOffsetUpper);
+    
+    //==================================================================================================================
+    // Every item has a priority between 1 and 52, so a whole compartment or rucksack fits into a single 64-bit mask
+    // with bit n being set if an item of priority n is in there; shared items are then just an AND away
+    using ItemMask = std::uint64_t;
+    
+    [[nodiscard]]
+    constexpr std::size_t getPriority(char item) noexcept
     {
-        std::size_t max = 0;
+        // Upper
+        if (item <= 'Z')
+        {
+            return (item - priorityOffsetUpper);
+        }
         
-        for (const char *rucksack : input)
+        // Lower
+        return (item - priorityOffsetLower);
+    }
+    
+    [[nodiscard]]
+    constexpr ItemMask getItemMask(const char *begin, const char *end) noexcept
+    {
+        ItemMask mask = 0;
+        
+        for (; begin != end; ++begin)
         {
-            const std::string_view entry { rucksack };
-            const std::size_t      csize = (entry.length() / 2);
-            
-            if (csize > max)
-            {
-                max = csize;
-            }
+            mask |= (ItemMask(1) << getPriority(*begin));
         }
         
-        return max;
-    }();
+        return mask;
+    }
     
-    constexpr std::size_t priorityOffsetLower = ('a' -  1);
-    constexpr std::size_t priorityOffsetUpper = ('A' - 27);
+    [[nodiscard]]
+    constexpr ItemMask getItemMask(std::string_view items) noexcept
+    {
+        return getItemMask(items.data(), items.data() + items.size());
+    }
     
-    //==================================================================================================================
-    using UniqueArray = std::array<char, maxCompartmentSize>;
+    /** Sums up the priorities of all items in the mask. */
+    [[nodiscard]]
+    constexpr std::size_t sumPriorities(ItemMask mask) noexcept
+    {
+        std::size_t priorities = 0;
+        
+        for (; mask != 0; mask &= (mask - 1))
+        {
+            priorities += aoc::countTrailingZeros(mask);
+        }
+        
+        return priorities;
+    }
     
-    //==================================================================================================================
+    /** Gets the priority of the lowest item in the mask, there should only be one anyway. */
     [[nodiscard]]
-    constexpr auto filterCompartmentDuplicates(std::string_view data)
+    constexpr std::size_t getBadgePriority(ItemMask badge) noexcept
+    {
+        return (badge != 0 ? static_cast<std::size_t>(aoc::countTrailingZeros(badge)) : 0);
+    }
+    
+    //==================================================================================================================
+    // Both compartments of a rucksack
+    struct RucksackMasks
     {
-        UniqueArray buffer {};
-        int         index = 0;
+        //==============================================================================================================
+        ItemMask compartment1;
+        ItemMask compartment2;
         
-        for (const char c : data)
+        //==============================================================================================================
+        // This is deliberately not built on getItemMask: the compiler memoises constexpr calls by their arguments,
+        // and a pointer pair per compartment makes that cache grow by gigabytes on large compile-time inputs
+        [[nodiscard]]
+        static constexpr RucksackMasks fromRucksack(std::string_view rucksack) noexcept
         {
-            auto it = buffer.begin();
+            const char        *items = rucksack.data();
+            const std::size_t middle = (rucksack.size() / 2);
+            RucksackMasks     masks { 0, 0 };
             
-            for (; *it != 0; ++it)
+            for (std::size_t i = 0; i < middle; ++i)
             {
-                if (*it == c)
-                {
-                    break;
-                }
+                masks.compartment1 |= (ItemMask(1) << getPriority(items[i]));
             }
             
-            if (*it == 0)
+            for (std::size_t i = middle; i < rucksack.size(); ++i)
             {
-                buffer[index++] = c;
+                masks.compartment2 |= (ItemMask(1) << getPriority(items[i]));
             }
+            
+            return masks;
         }
         
-        return buffer;
+        //==============================================================================================================
+        [[nodiscard]]
+        constexpr ItemMask shared() const noexcept
+        {
+            return (compartment1 & compartment2);
+        }
+        
+        [[nodiscard]]
+        constexpr ItemMask all() const noexcept
+        {
+            return (compartment1 | compartment2);
+        }
+    };
+    
+    /** Gets the priorities of all items that are in both compartments of a rucksack. */
+    [[nodiscard]]
+    constexpr std::size_t evaluateRucksack(std::string_view rucksack) noexcept
+    {
+        return sumPriorities(RucksackMasks::fromRucksack(rucksack).shared());
     }
     
-    //==================================================================================================================
-    template<const auto &AllInputs, std::size_t Index>
-    struct Group
+    /** Gets the priority of the badge, the one item all three rucksacks share. */
+    [[nodiscard]]
+    constexpr std::size_t evaluateBadge(std::string_view rucksack1,
+                                        std::string_view rucksack2,
+                                        std::string_view rucksack3) noexcept
     {
-        //==============================================================================================================
-        using NextGroup = std::conditional_t<((Index + 3) == AllInputs.size()), void, Group<AllInputs, Index + 3>>;
+        return getBadgePriority(getItemMask(rucksack1) & getItemMask(rucksack2) & getItemMask(rucksack3));
+    }
+    
+    // The runtime versions, they work on any list of rucksacks
+    template<class Container>
+    [[nodiscard]]
+    constexpr std::size_t evaluateAllRucksacks(const Container &rucksacks) noexcept
+    {
+        std::size_t priorities = 0;
         
-        //==============================================================================================================
-        static constexpr std::array<std::string_view, 3> group {
-            AllInputs[Index],
-            AllInputs[Index + 1],
-            AllInputs[Index + 2]
-        };
-    };
+        for (const std::string_view rucksack : rucksacks)
+        {
+            priorities += evaluateRucksack(rucksack);
+        }
+        
+        return priorities;
+    }
     
-    template<const auto &AllInputs, std::size_t Index>
-    struct Entry
+    template<class Container>
+    [[nodiscard]]
+    constexpr std::size_t evaluateAllBadges(const Container &rucksacks) noexcept
     {
-        static constexpr std::string_view value = AllInputs[Index];
-    };
+        std::size_t priorities = 0;
+        
+        for (std::size_t i = 0; (i + 2) < std::size(rucksacks); i += 3)
+        {
+            priorities += evaluateBadge(rucksacks[i], rucksacks[i + 1], rucksacks[i + 2]);
+        }
+        
+        return priorities;
+    }
     
-    template<class Input, std::size_t Offset, std::size_t Length>
-    struct Compartment
+    //==================================================================================================================
+    // Both answers of a list of rucksacks
+    struct Priorities
     {
-        static constexpr std::string_view inventory = std::string_view(Input::value).substr(Offset, Length);
+        std::size_t duplicates;
+        std::size_t badges;
     };
     
-    template<class Input>
-    struct Rucksack
+    //==================================================================================================================
+    // The vectorised versions of RucksackMasks::fromRucksack, they map a whole block of items to priorities at once.
+    // A priority p is split into the byte (p / 8) and the bit (p % 8) of the mask it belongs to; the bit is looked up
+    // (or computed) for every lane, and for each of the 7 mask bytes every lane whose byte matches adds its bit.
+    // Lanes past the end of a compartment get priority 0, which is no item and cleared at the very end.
+    using MaskKernel = RucksackMasks(*)(std::string_view);
+    
+    constexpr int maskBytes = 7; // 52 priorities + the unused 0 fit into 7 bytes
+    
+#if AOC_HAS_SSE2
+    [[nodiscard]]
+    inline __m128i toPrioritiesSse2(__m128i items) noexcept
     {
-        //==============================================================================================================
-        static constexpr std::string_view input { Input::value };
-        static constexpr std::size_t      inventoryOffset = (input.size() / 2);
+        // Upper: c - priorityOffsetUpper, lower: the same minus priorityOffsetDelta
+        const __m128i valid = _mm_cmpgt_epi8(items, _mm_setzero_si128());
+        const __m128i lower = _mm_cmpgt_epi8(items, _mm_set1_epi8('Z'));
+        const __m128i upper_priorities = _mm_sub_epi8(items, _mm_set1_epi8(static_cast<char>(priorityOffsetUpper)));
+        const __m128i lower_delta      = _mm_and_si128(lower, _mm_set1_epi8(priorityOffsetDelta));
+        return _mm_and_si128(_mm_sub_epi8(upper_priorities, lower_delta), valid);
+    }
+    
+    [[nodiscard]]
+    inline ItemMask getItemMaskSse2(const char *begin, const char *end) noexcept
+    {
+        __m128i accumulators[maskBytes]; // NOLINT
         
-        //==============================================================================================================
-        using Compartment1 = Compartment<Input, 0,               inventoryOffset>;
-        using Compartment2 = Compartment<Input, inventoryOffset, (input.length() - inventoryOffset)>;
+        for (__m128i &accumulator : accumulators)
+        {
+            accumulator = _mm_setzero_si128();
+        }
         
-        //==============================================================================================================
-        [[nodiscard]]
-        static constexpr std::size_t calculatePriorities() noexcept
+        const __m128i low_bits = _mm_set1_epi8(7);
+        
+        for (; begin < end; begin += 16)
         {
-            std::size_t       priorities = 0;
-            const UniqueArray filtered   = filterCompartmentDuplicates(Compartment1::inventory);
+            __m128i items;
+            
+            if ((end - begin) >= 16)
+            {
+                items = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)); // NOLINT
+            }
+            else
+            {
+                std::array<char, 16> buffer {};
+                (void) std::memcpy(buffer.data(), begin, static_cast<std::size_t>(end - begin));
+                items = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer.data())); // NOLINT
+            }
             
-            for (auto it = filtered.begin(); *it != 0; ++it)
+            const __m128i priorities = toPrioritiesSse2(items);
+            const __m128i bit_index  = _mm_and_si128(priorities, low_bits);
+            const __m128i byte_index = _mm_and_si128(_mm_srli_epi16(priorities, 3), low_bits);
+            
+            // SSE2 can't shift or shuffle bytes individually, so "1 << bit_index" is built by doubling the lanes:
+            // once for bit 0 of the index, twice for bit 1 and four times for bit 2
+            __m128i bits = _mm_set1_epi8(1);
+            
+            for (int shift = 0; shift < 3; ++shift)
             {
-                const char c = *it;
+                const __m128i flag = _mm_set1_epi8(static_cast<char>(1 << shift));
+                const __m128i take = _mm_cmpeq_epi8(_mm_and_si128(bit_index, flag), flag);
+                __m128i shifted    = bits;
                 
-                for (const char c2 : Compartment2::inventory)
+                for (int i = 0; i < (1 << shift); ++i)
                 {
-                    if (c == c2)
-                    {
-                        // Upper
-                        if (c <= 'Z')
-                        {
-                            priorities += (c - priorityOffsetUpper);
-                        }
-                        
-                        // Lower
-                        else
-                        {
-                            priorities += (c - priorityOffsetLower);
-                        }
-                        
-                        break;
-                    }
+                    shifted = _mm_add_epi8(shifted, shifted);
                 }
+                
+                bits = _mm_or_si128(_mm_andnot_si128(take, bits), _mm_and_si128(take, shifted));
             }
             
-            return priorities;
+            for (int i = 0; i < maskBytes; ++i)
+            {
+                const __m128i in_byte = _mm_cmpeq_epi8(byte_index, _mm_set1_epi8(static_cast<char>(i)));
+                accumulators[i] = _mm_or_si128(accumulators[i], _mm_and_si128(in_byte, bits));
+            }
         }
-    };
+        
+        ItemMask mask = 0;
+        
+        for (int i = 0; i < maskBytes; ++i)
+        {
+            __m128i reduced = accumulators[i];
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 8));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 4));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 2));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 1));
+            
+            mask |= (ItemMask(_mm_cvtsi128_si32(reduced) & 0xFF) << (i * 8));
+        }
+        
+        return (mask & ~ItemMask(1));
+    }
     
-    template<std::size_t Size, std::size_t Offset, class Sequence = std::make_index_sequence<Size>>
-    struct make_index_sequence_off;
+    [[nodiscard]]
+    RucksackMasks fromRucksackSse2(std::string_view rucksack) noexcept
+    {
+        const char *items  = rucksack.data();
+        const char *middle = items + (rucksack.size() / 2);
+        return { getItemMaskSse2(items, middle), getItemMaskSse2(middle, items + rucksack.size()) };
+    }
+#endif
     
-    template<std::size_t Size, std::size_t ...Indices, std::size_t Offset>
-    struct make_index_sequence_off<Size, Offset, std::index_sequence<Indices...>>
+#if AOC_HAS_AVX2_DISPATCH
+    AOC_TARGET_AVX2
+    [[nodiscard]]
+    inline ItemMask getItemMaskAvx2(const char *begin, const char *end) noexcept
     {
-        using type = std::index_sequence<Indices + Offset...>;
-    };
+        __m256i accumulators[maskBytes]; // NOLINT
+        
+        for (__m256i &accumulator : accumulators)
+        {
+            accumulator = _mm256_setzero_si256();
+        }
+        
+        const __m256i low_bits  = _mm256_set1_epi8(7);
+        const __m256i bit_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                   1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        
+        for (; begin < end; begin += 32)
+        {
+            __m256i items;
+            
+            if ((end - begin) >= 32)
+            {
+                items = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)); // NOLINT
+            }
+            else
+            {
+                std::array<char, 32> buffer {};
+                (void) std::memcpy(buffer.data(), begin, static_cast<std::size_t>(end - begin));
+                items = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer.data())); // NOLINT
+            }
+            
+            const __m256i valid = _mm256_cmpgt_epi8(items, _mm256_setzero_si256());
+            const __m256i lower = _mm256_cmpgt_epi8(items, _mm256_set1_epi8('Z'));
+            const __m256i upper = _mm256_sub_epi8(items, _mm256_set1_epi8(static_cast<char>(priorityOffsetUpper)));
+            const __m256i lower_delta = _mm256_and_si256(lower, _mm256_set1_epi8(priorityOffsetDelta));
+            const __m256i priorities  = _mm256_and_si256(_mm256_sub_epi8(upper, lower_delta), valid);
+            
+            const __m256i bits       = _mm256_shuffle_epi8(bit_table, _mm256_and_si256(priorities, low_bits));
+            const __m256i byte_index = _mm256_and_si256(_mm256_srli_epi16(priorities, 3), low_bits);
+            
+            for (int i = 0; i < maskBytes; ++i)
+            {
+                const __m256i in_byte = _mm256_cmpeq_epi8(byte_index, _mm256_set1_epi8(static_cast<char>(i)));
+                accumulators[i] = _mm256_or_si256(accumulators[i], _mm256_and_si256(in_byte, bits));
+            }
+        }
+        
+        ItemMask mask = 0;
+        
+        for (int i = 0; i < maskBytes; ++i)
+        {
+            __m128i reduced = _mm_or_si128(_mm256_castsi256_si128(accumulators[i]),
+                                           _mm256_extracti128_si256(accumulators[i], 1));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 8));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 4));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 2));
+            reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 1));
+            
+            mask |= (ItemMask(_mm_cvtsi128_si32(reduced) & 0xFF) << (i * 8));
+        }
+        
+        return (mask & ~ItemMask(1));
+    }
     
-    template<std::size_t Size, std::size_t Offset>
-    using make_index_sequence_off_t = typename make_index_sequence_off<Size, Offset>::type;
+    AOC_TARGET_AVX2
+    [[nodiscard]]
+    RucksackMasks fromRucksackAvx2(std::string_view rucksack) noexcept
+    {
+        const char *items  = rucksack.data();
+        const char *middle = items + (rucksack.size() / 2);
+        return { getItemMaskAvx2(items, middle), getItemMaskAvx2(middle, items + rucksack.size()) };
+    }
+#endif
     
-    // A simple placeholder with a list of index sequences, we can unpack this one to make use of them individually
-    template<class ...IndexSequences>
-    struct ISeqArray {};
+    [[nodiscard]]
+    RucksackMasks fromRucksackScalar(std::string_view rucksack) noexcept
+    {
+        return RucksackMasks::fromRucksack(rucksack);
+    }
     
-    // We want to split up our indices into several std::index_sequence types
-    template<std::size_t Size, std::size_t LastSize, class ...Sequences>
-    struct IndexSequenceSplitter
-        : IndexSequenceSplitter<Size,
-                                LastSize + std::min<std::size_t>(Size - LastSize, 50),
-                                Sequences...,
-                                make_index_sequence_off_t<std::min<std::size_t>(Size - LastSize, 50), LastSize>>
-    {};
+    /** Gets a kernel by name, or the best one this cpu supports if no name was given. */
+    [[nodiscard]]
+    std::pair<MaskKernel, std::string_view> selectMaskKernel(std::string_view name = {}) noexcept
+    {
+    #if AOC_HAS_AVX2_DISPATCH
+        if ((name.empty() || name == "avx2") && aoc::cpuSupportsAvx2())
+        {
+            return { fromRucksackAvx2, "avx2" };
+        }
+    #endif
+        
+    #if AOC_HAS_SSE2
+        if (name.empty() || name == "sse2")
+        {
+            return { fromRucksackSse2, "sse2" };
+        }
+    #endif
+        
+        return { fromRucksackScalar, "scalar" };
+    }
     
-    template<std::size_t Size, class ...Sequences>
-    struct IndexSequenceSplitter<Size, Size, Sequences...>
+    //==================================================================================================================
+    // Strips everything that is not part of a rucksack, this way we can take either the plain puzzle input
+    // or our own format with one string literal per line (as is used by the compile-time evaluation)
+    [[nodiscard]]
+    std::string_view trimRucksack(const char *begin, const char *end) noexcept
     {
-        using type = ISeqArray<Sequences...>;
-    };
+        while (begin != end && (aoc::isWhitespace(*begin) || *begin == '"'))
+        {
+            (void) ++begin;
+        }
+        
+        while (begin != end && (aoc::isWhitespace(*(end - 1)) || *(end - 1) == '"' || *(end - 1) == ','))
+        {
+            (void) --end;
+        }
+        
+        return { begin, static_cast<std::size_t>(end - begin) };
+    }
     
-    // We want to split up our fold expressions to max 50 calculations, because there is a limit to them (which we are exceeding)
-    template<const auto &AllInputs, std::size_t Result, class ...IndexSequences>
-    struct FoldExpressionSplitter;
+    /** Gets the next rucksack whose line starts before end and moves pos behind it, empty if there is none. */
+    [[nodiscard]]
+    std::string_view nextRucksack(const char *&pos, const char *end, const char *fileEnd) noexcept
+    {
+        while (pos < end)
+        {
+            const void *newline  = std::memchr(pos, '\n', static_cast<std::size_t>(fileEnd - pos));
+            const char *line_end = (newline != nullptr ? static_cast<const char*>(newline) : fileEnd);
+            
+            const std::string_view rucksack = trimRucksack(pos, line_end);
+            pos = (newline != nullptr ? line_end + 1 : fileEnd);
+            
+            if (!rucksack.empty())
+            {
+                return rucksack;
+            }
+        }
+        
+        return {};
+    }
     
-    template<const auto &AllInputs, std::size_t Result, class ...OtherSequences, std::size_t ...CurrentIndices>
-    struct FoldExpressionSplitter<AllInputs, Result, std::index_sequence<CurrentIndices...>, OtherSequences...>
-        : FoldExpressionSplitter<AllInputs,
-                                 Result + (Rucksack<Entry<AllInputs, CurrentIndices>>::calculatePriorities() + ...),
-                                 OtherSequences...>
-    {};
+    // Reads a list of rucksacks at runtime
+    [[nodiscard]]
+    std::vector<std::string_view> readRucksacks(const aoc::MappedFile &file)
+    {
+        std::vector<std::string_view> rucksacks;
+        
+        for (const char *pos = file.begin();;)
+        {
+            const std::string_view rucksack = nextRucksack(pos, file.end(), file.end());
+            
+            if (rucksack.empty())
+            {
+                break;
+            }
+            
+            rucksacks.push_back(rucksack);
+        }
+        
+        return rucksacks;
+    }
     
-    template<const auto &AllInputs, std::size_t Result, std::size_t ...CurrentIndices>
-    struct FoldExpressionSplitter<AllInputs, Result, std::index_sequence<CurrentIndices...>>
+    //==================================================================================================================
+    // The fused pipeline, it walks the input only once in groups of three and gets both answers out of every rucksack
+    // while it's still hot in cache. For multiple threads the input is cut into line aligned ranges; a range evaluates
+    // all groups starting in it, so first every range counts its rucksacks to know where its first group starts.
+    [[nodiscard]]
+    std::size_t countRucksacks(const char *begin, const char *end, const char *fileEnd) noexcept
     {
-        static constexpr std::size_t value
-            = (Result + (Rucksack<Entry<AllInputs, CurrentIndices>>::calculatePriorities() + ...));
-    };
+        std::size_t count = 0;
+        
+        for (const char *pos = begin; !nextRucksack(pos, end, fileEnd).empty();)
+        {
+            (void) ++count;
+        }
+        
+        return count;
+    }
     
-    // A tiny wrapper
-    template<const auto &AllInputs, class IndexSequenceArray>
-    struct PriorityEvaluator;
+    [[nodiscard]]
+    Priorities evaluateFused(const char  *begin,
+                             const char  *end,
+                             const char  *fileEnd,
+                             std::size_t skip,
+                             MaskKernel  kernel) noexcept
+    {
+        Priorities result { 0, 0 };
+        const char *pos = begin;
+        
+        // These still belong to a group of a previous range
+        for (; skip > 0; --skip)
+        {
+            if (nextRucksack(pos, end, fileEnd).empty())
+            {
+                return result;
+            }
+        }
+        
+        for (std::string_view first; !(first = nextRucksack(pos, end, fileEnd)).empty();)
+        {
+            const RucksackMasks masks = kernel(first);
+            
+            result.duplicates += sumPriorities(masks.shared());
+            ItemMask badge     = masks.all();
+            int      members   = 1;
+            
+            // The rest of the group may reach into the next range
+            for (std::string_view member; members < 3 && !(member = nextRucksack(pos, fileEnd, fileEnd)).empty();)
+            {
+                const RucksackMasks member_masks = kernel(member);
+                
+                result.duplicates += sumPriorities(member_masks.shared());
+                badge             &= member_masks.all();
+                (void) ++members;
+            }
+            
+            // An incomplete group at the end has no badge
+            if (members == 3)
+            {
+                result.badges += getBadgePriority(badge);
+            }
+        }
+        
+        return result;
+    }
     
-    template<const auto &AllInputs, class ...IndexSequences>
-    struct PriorityEvaluator<AllInputs, ISeqArray<IndexSequences...>>
+    [[nodiscard]]
+    Priorities evaluateFused(const aoc::MappedFile &file, MaskKernel kernel, aoc::ThreadPool &pool)
     {
-        static constexpr int priorities = FoldExpressionSplitter<AllInputs, 0, IndexSequences...>::value;
-    };
+        const std::size_t              range_count = (pool.size() * 4);
+        const std::vector<const char*> borders     = aoc::splitAtLines(file.begin(), file.end(), range_count);
+        
+        std::vector<std::future<std::size_t>> counts;
+        
+        for (std::size_t i = 0; i < range_count; ++i)
+        {
+            counts.push_back(pool.submit([begin = borders[i], end = borders[i + 1], &file]()
+            {
+                return countRucksacks(begin, end, file.end());
+            }));
+        }
+        
+        std::vector<std::future<Priorities>> results;
+        std::size_t                          first_index = 0;
+        
+        for (std::size_t i = 0; i < range_count; ++i)
+        {
+            const std::size_t skip = ((3 - (first_index % 3)) % 3);
+            first_index += counts[i].get();
+            
+            results.push_back(pool.submit([begin = borders[i], end = borders[i + 1], skip, kernel, &file]()
+            {
+                return evaluateFused(begin, end, file.end(), skip, kernel);
+            }));
+        }
+        
+        Priorities result { 0, 0 };
+        
+        for (std::future<Priorities> &range_result : results)
+        {
+            const Priorities priorities = range_result.get();
+            result.duplicates += priorities.duplicates;
+            result.badges     += priorities.badges;
+        }
+        
+        return result;
+    }
     
-    // Evaluates all badge's priorities
-    template<class Group>
-    struct BadgeEvaluator
+    //==================================================================================================================
+    // The input is evaluated in chunks, every chunk is its own constant evaluation with a plain constexpr loop,
+    // that way neither the instantiation depth nor any constant evaluation limit depends on the size of the input.
+    // A chunk is always a multiple of 3, so groups never span over two of them
+    constexpr std::size_t chunkSize = (3 * 256);
+    
+    template<const auto &AllInputs, std::size_t Index>
+    struct Chunk
     {
-    private:
-        using Next = typename Group::NextGroup;
+        //==============================================================================================================
+        static constexpr std::size_t begin = (Index * chunkSize);
+        static constexpr std::size_t end   = std::min<std::size_t>(begin + chunkSize, AllInputs.size());
         
         //==============================================================================================================
-        static constexpr std::size_t evaluateGroup()
+        // Every rucksack is only looked at once and serves both, its own priorities and the badge of its group
+        static constexpr Priorities result = []()
         {
-            for (const char c : Group::group[0])
+            Priorities  result { 0, 0 };
+            std::size_t i      = begin;
+            
+            for (; (i + 2) < end; i += 3)
             {
-                for (const char c2 : Group::group[1])
+                ItemMask badge = ~ItemMask(0);
+                
+                for (std::size_t member = i; member < (i + 3); ++member)
                 {
-                    if (c == c2)
-                    {
-                        for (const char c3 : Group::group[2])
-                        {
-                            if (c2 == c3)
-                            {
-                                // Upper
-                                if (c <= 'Z')
-                                {
-                                    return (c - priorityOffsetUpper);
-                                }
-                                
-                                // Lower
-                                else
-                                {
-                                    return (c - priorityOffsetLower);
-                                }
-                                
-                                break;
-                            }
-                        }
-                    }
+                    const RucksackMasks masks = RucksackMasks::fromRucksack(AllInputs[member]);
+                    
+                    result.duplicates += sumPriorities(masks.shared());
+                    badge             &= masks.all();
                 }
+                
+                result.badges += getBadgePriority(badge);
             }
             
-            return 0;
-        }
-        
-        static constexpr std::size_t getNext()
-        {
-            if constexpr (std::is_same_v<Next, void>)
+            // An incomplete group at the end has no badge
+            for (; i < end; ++i)
             {
-                return 0;
+                result.duplicates += evaluateRucksack(AllInputs[i]);
             }
-            else
+            
+            return result;
+        }();
+    };
+    
+    // Every chunk is expanded into an array rather than a fold expression, which is flat no matter how many chunks
+    // there are (a fold nests one level deeper per operand and will eventually hit the compiler's bracket limit)
+    template<const auto &AllInputs,
+             class Chunks = std::make_index_sequence<(AllInputs.size() + chunkSize - 1) / chunkSize>>
+    struct ChunkEvaluator;
+    
+    template<const auto &AllInputs, std::size_t ...Chunks>
+    struct ChunkEvaluator<AllInputs, std::index_sequence<Chunks...>>
+    {
+    private:
+        template<std::size_t N>
+        static constexpr std::size_t sum(const std::array<std::size_t, N> &values) noexcept
+        {
+            std::size_t result = 0;
+            
+            for (const std::size_t value : values)
             {
-                return BadgeEvaluator<Next>::priorities;
+                result += value;
             }
+            
+            return result;
         }
         
     public:
-        static constexpr std::size_t priorities = evaluateGroup() + getNext();
+        static constexpr std::size_t priorities
+            = sum(std::array<std::size_t, sizeof...(Chunks)> { Chunk<AllInputs, Chunks>::result.duplicates... });
+        
+        static constexpr std::size_t badgePriorities
+            = sum(std::array<std::size_t, sizeof...(Chunks)> { Chunk<AllInputs, Chunks>::result.badges... });
+    };
+    
+    // Evaluates all duplicate item priorities
+    template<const auto &AllInputs>
+    struct PriorityEvaluator
+    {
+        static constexpr std::size_t priorities = ChunkEvaluator<AllInputs>::priorities;
+    };
+    
+    // Evaluates all badge's priorities
+    template<const auto &AllInputs>
+    struct BadgeEvaluator
+    {
+        static constexpr std::size_t priorities = ChunkEvaluator<AllInputs>::badgePriorities;
     };
 }
 //======================================================================================================================
@@ -281,12 +678,88 @@ namespace
 //**********************************************************************************************************************
 // region Main
 //======================================================================================================================
-int main()
+int main(int argc, char **argv)
 {
-    using IndexList = ::IndexSequenceSplitter<::input.size(), 0>::type;
-    std::cout << "All duplicates priorities is: " << ::PriorityEvaluator<::input, IndexList>::priorities << '\n';
+    // Usage: day_3 [--kernel scalar|sse2|avx2] [--threads N] [--validate] [input file]
+    std::string_view kernel_name;
+    std::size_t      thread_count = 1;
+    bool             validate     = false;
+    const char       *input_url   = nullptr;
     
-    std::cout << "All badge's priorities is: " << ::BadgeEvaluator<::Group<::input, 0>>::priorities << '\n';
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg(argv[i]);
+        
+        if (arg == "--kernel" && (i + 1) < argc)
+        {
+            kernel_name = argv[++i];
+        }
+        else if (arg == "--threads" && (i + 1) < argc)
+        {
+            thread_count = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--validate")
+        {
+            validate = true;
+        }
+        else
+        {
+            input_url = argv[i];
+        }
+    }
+    
+#if AOC_DAY3_COMPILE_TIME
+    if (input_url == nullptr)
+    {
+        std::cout << "All duplicates priorities is: " << ::PriorityEvaluator<::input>::priorities << '\n';
+        
+        std::cout << "All badge's priorities is: " << ::BadgeEvaluator<::input>::priorities << '\n';
+        
+        return 0;
+    }
+#else
+    if (input_url == nullptr)
+    {
+        input_url = INPUT_FILE;
+    }
+#endif
+    
+    try
+    {
+        const aoc::MappedFile file(input_url);
+        const auto [kernel, name] = ::selectMaskKernel(kernel_name);
+        
+        ::Priorities result {};
+        
+        if (thread_count == 1)
+        {
+            result = ::evaluateFused(file.begin(), file.end(), file.end(), 0, kernel);
+        }
+        else
+        {
+            aoc::ThreadPool pool(thread_count);
+            result = ::evaluateFused(file, kernel, pool);
+        }
+        
+        std::cout << "All duplicates priorities is: " << result.duplicates << '\n';
+        
+        std::cout << "All badge's priorities is: " << result.badges << '\n';
+        
+        if (validate)
+        {
+            const std::vector<std::string_view> rucksacks = ::readRucksacks(file);
+            
+            const bool matches = (result.duplicates == ::evaluateAllRucksacks(rucksacks)
+                               && result.badges     == ::evaluateAllBadges(rucksacks));
+            std::cout << "Validation of the " << name << " kernel " << (matches ? "passed" : "FAILED") << '\n';
+            return (matches ? 0 : 1);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cout << "Exception caught: " << ex.what();
+        return 1;
+    }
     
     return 0;
 }
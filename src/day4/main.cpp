@@ -15,10 +15,31 @@
     ====================================================================================================================
  */
 
+#include "../aoc_mapped_file.h"
+#include "../aoc_simd.h"
+#include "../aoc_thread_pool.h"
+#include "../aoc_utility.h"
+
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <random>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 
@@ -28,11 +49,14 @@
 namespace
 {
     //==================================================================================================================
+    /** The type of a section id. */
+    using SectionId = std::int64_t;
+    
     // A range of section ids
     struct Section
     {
-        int startNr;
-        int endNr;
+        SectionId startNr;
+        SectionId endNr;
     };
     
     // A pair of elves that define their sections
@@ -61,7 +85,7 @@ namespace
         [[nodiscard]]
         static ElfPair fromString(const std::string &input) noexcept
         {
-            ElfPair pair;
+            ElfPair pair {};
             
             const std::array vars {
                 &pair.sectionElf1.startNr,
@@ -71,59 +95,1110 @@ namespace
             };
             auto var_it = vars.begin();
             
-            for (auto it = input.begin(); it != input.end(); ++it)
+            for (const char *it = input.data(), *end = input.data() + input.size(); it != end && var_it != vars.end();)
             {
-                std::array<char, 4> buffer { *it };
-                auto buf_it = buffer.begin() + 1;
-                
-                for (; (std::next(it) != input.end() && *it >= '0' && *it <= '9'); ++it)
+                if (!aoc::isDigit(*it))
                 {
-                    *buf_it++ = *std::next(it);
+                    (void) ++it;
+                    continue;
                 }
                 
-                const int result = std::strtol(buffer.data(), nullptr, 10);
-                *(*var_it++) = result;
+                it = std::from_chars(it, end, *(*var_it++)).ptr;
             }
             
             return pair;
         }
     };
+    
+    //==================================================================================================================
+    // All pairs of the input as structure of arrays, so that we can compare many of them at once
+    template<class T>
+    struct SectionColumns
+    {
+        std::vector<T> start1;
+        std::vector<T> end1;
+        std::vector<T> start2;
+        std::vector<T> end2;
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        std::size_t size() const noexcept
+        {
+            return start1.size();
+        }
+    };
+    
+    // Finds the numbers in a buffer and calls "callback(value)" for each, in order.
+    // Digits are classified 16 bytes at a time; the starts and ends of numbers fall out of the digit mask
+    // and its shifted version, so there are no per-character branches apart from the digit accumulation.
+    template<class Fn>
+    void forEachNumber(const char *begin, const char *end, Fn &&callback)
+    {
+        const auto parse = [&callback](const char *first, const char *last)
+        {
+            std::uint64_t value = 0;
+            
+            for (; first != last; ++first)
+            {
+                value = (value * 10) + static_cast<std::uint64_t>(*first - '0');
+            }
+            
+            callback(value);
+        };
+        
+        const char *pos          = begin;
+        const char *number_start = nullptr;
+        
+    #if AOC_HAS_SSE2
+        const __m128i below_zero = _mm_set1_epi8('0' - 1);
+        const __m128i above_nine = _mm_set1_epi8('9' + 1);
+        std::uint32_t carry      = 0; // Whether the last byte of the previous block was a digit
+        
+        for (; (end - pos) >= 16; pos += 16)
+        {
+            const __m128i block  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)); // NOLINT
+            const __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(block, below_zero), _mm_cmplt_epi8(block, above_nine));
+            
+            const auto digit_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(digits));
+            const auto previous   = ((digit_mask << 1) | carry);
+            
+            std::uint32_t starts = (digit_mask & ~previous);
+            std::uint32_t ends   = (~digit_mask & previous & 0xFFFF);
+            carry                = (digit_mask >> 15);
+            
+            // Numbers are always ended before the next one starts, but the one ending here could have started earlier
+            while ((starts | ends) != 0)
+            {
+                const int next_start = aoc::countTrailingZeros(starts);
+                const int next_end   = aoc::countTrailingZeros(ends);
+                
+                if (next_end < next_start)
+                {
+                    parse(number_start, pos + next_end);
+                    ends &= (ends - 1);
+                }
+                else
+                {
+                    number_start = pos + next_start;
+                    starts      &= (starts - 1);
+                }
+            }
+        }
+        
+        if (carry == 0)
+        {
+            number_start = nullptr;
+        }
+    #endif
+        
+        for (; pos != end; ++pos)
+        {
+            if (aoc::isDigit(*pos))
+            {
+                if (number_start == nullptr)
+                {
+                    number_start = pos;
+                }
+            }
+            else if (number_start != nullptr)
+            {
+                parse(number_start, pos);
+                number_start = nullptr;
+            }
+        }
+        
+        if (number_start != nullptr)
+        {
+            parse(number_start, end);
+        }
+    }
+    
+    // Parses a whole input into columns, returns false if a number doesn't fit into T.
+    // Every line has exactly four numbers, so the column is just the index of the number modulo 4.
+    template<class T>
+    [[nodiscard]]
+    bool parseColumns(const char *begin, const char *end, SectionColumns<T> &columns)
+    {
+        std::array<std::vector<T>*, 4> targets { &columns.start1, &columns.end1, &columns.start2, &columns.end2 };
+        
+        for (std::vector<T> *target : targets)
+        {
+            // Every line has at least 8 characters
+            target->reserve(static_cast<std::size_t>(end - begin) / 8);
+        }
+        
+        std::size_t index = 0;
+        bool        fits  = true;
+        
+        forEachNumber(begin, end, [&targets, &index, &fits](std::uint64_t value)
+        {
+            fits &= (value <= static_cast<std::uint64_t>(std::numeric_limits<T>::max()));
+            targets[index++ & 3]->push_back(static_cast<T>(value));
+        });
+        
+        // An incomplete last line is dropped
+        for (std::vector<T> *target : targets)
+        {
+            target->resize(index / 4);
+        }
+        
+        return fits;
+    }
+    
+    //==================================================================================================================
+    // Counts the contained and the intersecting pairs, 4 pairs at a time if they fit into 32-bit lanes
+    struct PairCounts
+    {
+        std::size_t contained;
+        std::size_t intersecting;
+    };
+    
+    template<class T>
+    [[nodiscard]]
+    PairCounts countPairs(const SectionColumns<T> &columns) noexcept
+    {
+        PairCounts  counts { 0, 0 };
+        std::size_t i = 0;
+        
+    #if AOC_HAS_SSE2
+        if constexpr (std::is_same_v<T, std::int32_t>)
+        {
+            const auto load = [](const std::vector<T> &column, std::size_t index)
+            {
+                return _mm_loadu_si128(reinterpret_cast<const __m128i*>(column.data() + index)); // NOLINT
+            };
+            
+            // a >= b is !(b > a), so every "or" of two such terms becomes an "and not" of the complements
+            const auto greater_equal = [](__m128i a, __m128i b)
+            {
+                return _mm_xor_si128(_mm_cmpgt_epi32(b, a), _mm_set1_epi32(-1));
+            };
+            
+            for (; (i + 4) <= columns.size(); i += 4)
+            {
+                const __m128i s1 = load(columns.start1, i);
+                const __m128i e1 = load(columns.end1,   i);
+                const __m128i s2 = load(columns.start2, i);
+                const __m128i e2 = load(columns.end2,   i);
+                
+                const __m128i contained = _mm_or_si128(_mm_and_si128(greater_equal(s1, s2), greater_equal(e2, e1)),
+                                                       _mm_and_si128(greater_equal(s2, s1), greater_equal(e1, e2)));
+                const __m128i intersect = _mm_or_si128(_mm_and_si128(greater_equal(e1, s2), greater_equal(e2, e1)),
+                                                       _mm_and_si128(greater_equal(e2, s1), greater_equal(e1, e2)));
+                
+                counts.contained    += aoc::popCount(_mm_movemask_ps(_mm_castsi128_ps(contained)));
+                counts.intersecting += aoc::popCount(_mm_movemask_ps(_mm_castsi128_ps(intersect)));
+            }
+        }
+    #endif
+        
+        for (; i < columns.size(); ++i)
+        {
+            const ElfPair pair {
+                { columns.start1[i], columns.end1[i] },
+                { columns.start2[i], columns.end2[i] }
+            };
+            
+            counts.contained    += pair.containsContained();
+            counts.intersecting += pair.intersects();
+        }
+        
+        return counts;
+    }
+    
+    [[nodiscard]]
+    bool countPairs(const char *inputUrl, PairCounts &counts)
+    {
+        try
+        {
+            const aoc::MappedFile file(inputUrl);
+            
+            if (SectionColumns<std::int32_t> columns; parseColumns(file.begin(), file.end(), columns))
+            {
+                counts = countPairs(columns);
+                return true;
+            }
+            
+            // Section ids too big for 32-bit lanes
+            SectionColumns<std::int64_t> wide_columns;
+            
+            if (!parseColumns(file.begin(), file.end(), wide_columns))
+            {
+                return false;
+            }
+            
+            counts = countPairs(wide_columns);
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    
+    [[nodiscard]]
+    bool countPairsReference(const char *inputUrl, PairCounts &counts)
+    {
+        std::fstream input(inputUrl);
+        
+        if (!input.is_open())
+        {
+            return false;
+        }
+        
+        std::string line;
+        counts = { 0, 0 };
+        
+        while (std::getline(input, line))
+        {
+            const ::ElfPair pair = ::ElfPair::fromString(line);
+            
+            if (pair.containsContained())
+            {
+                (void) ++counts.contained;
+            }
+            
+            if (pair.intersects())
+            {
+                (void) ++counts.intersecting;
+            }
+        }
+        
+        return true;
+    }
+    
+    //==================================================================================================================
+    // A single elf's assignment along with where it came from
+    struct Assignment
+    {
+        Section     section;
+        std::size_t line; // Starting at 1
+        int         elf;  // 1 or 2
+    };
+    
+    [[nodiscard]]
+    std::vector<Assignment> toAssignments(const SectionColumns<SectionId> &columns)
+    {
+        std::vector<Assignment> assignments;
+        assignments.reserve(columns.size() * 2);
+        
+        for (std::size_t i = 0; i < columns.size(); ++i)
+        {
+            assignments.push_back({ { columns.start1[i], columns.end1[i] }, i + 1, 1 });
+            assignments.push_back({ { columns.start2[i], columns.end2[i] }, i + 1, 2 });
+        }
+        
+        return assignments;
+    }
+    
+    // An index over all assignments of the roster.
+    // Which assignments cover a section is answered by a centered interval tree: every node holds the assignments
+    // containing its center, sorted by start and by end, so a query only reports from the front of one list per level.
+    // How many overlap a range only needs all starts and all ends sorted, since an assignment overlaps [a, b] unless
+    // it ends before a or starts after b. Conflicts between lines are found by a sweep over the assignments by start.
+    class SectionIndex
+    {
+    public:
+        explicit SectionIndex(std::vector<Assignment> parAssignments)
+            : assignments(std::move(parAssignments))
+        {
+            starts.reserve(assignments.size());
+            ends  .reserve(assignments.size());
+            
+            byStart.reserve(assignments.size());
+            
+            // Inverted sections cover nothing, so they are left out of the index altogether
+            for (std::size_t i = 0; i < assignments.size(); ++i)
+            {
+                if (start(i) <= end(i))
+                {
+                    starts .push_back(start(i));
+                    ends   .push_back(end(i));
+                    byStart.push_back(i);
+                }
+            }
+            
+            std::sort(starts.begin(), starts.end());
+            std::sort(ends  .begin(), ends  .end());
+            std::sort(byStart.begin(), byStart.end(), [this](std::size_t left, std::size_t right)
+            {
+                return (assignments[left].section.startNr < assignments[right].section.startNr);
+            });
+            
+            root = build(byStart);
+        }
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        const std::vector<Assignment>& getAssignments() const noexcept
+        {
+            return assignments;
+        }
+        
+        //==============================================================================================================
+        /** Calls "callback(assignment)" for every assignment that covers the given section. */
+        template<class Fn>
+        void forEachCovering(SectionId section, Fn &&callback) const
+        {
+            for (int node_index = root; node_index >= 0;)
+            {
+                const Node &node = nodes[static_cast<std::size_t>(node_index)];
+                
+                if (section < node.center)
+                {
+                    for (auto it = node.byStart.begin(); it != node.byStart.end() && start(*it) <= section; ++it)
+                    {
+                        callback(assignments[*it]);
+                    }
+                    
+                    node_index = node.left;
+                }
+                else
+                {
+                    for (auto it = node.byEnd.begin(); it != node.byEnd.end() && end(*it) >= section; ++it)
+                    {
+                        callback(assignments[*it]);
+                    }
+                    
+                    node_index = (section > node.center ? node.right : -1);
+                }
+            }
+        }
+        
+        /** Gets how many assignments share at least one section with the range [first, last]. */
+        [[nodiscard]]
+        std::size_t countOverlapping(SectionId first, SectionId last) const noexcept
+        {
+            if (first > last)
+            {
+                return 0;
+            }
+            
+            const auto ending_before  = std::lower_bound(ends.begin(),   ends.end(),   first) - ends.begin();
+            const auto starting_after = starts.end() - std::upper_bound(starts.begin(), starts.end(), last);
+            return (starts.size() - static_cast<std::size_t>(ending_before + starting_after));
+        }
+        
+        /** Calls "callback(first, second)" for every two overlapping assignments of different lines. */
+        template<class Fn>
+        void forEachConflict(Fn &&callback) const
+        {
+            // The assignments that have started but not yet ended, as min-heap by their end
+            const auto ends_later = [this](std::size_t left, std::size_t right) { return (end(left) > end(right)); };
+            std::vector<std::size_t> active;
+            
+            for (const std::size_t current : byStart)
+            {
+                while (!active.empty() && end(active.front()) < start(current))
+                {
+                    std::pop_heap(active.begin(), active.end(), ends_later);
+                    active.pop_back();
+                }
+                
+                for (const std::size_t other : active)
+                {
+                    if (assignments[other].line != assignments[current].line)
+                    {
+                        callback(assignments[other], assignments[current]);
+                    }
+                }
+                
+                active.push_back(current);
+                std::push_heap(active.begin(), active.end(), ends_later);
+            }
+        }
+        
+    private:
+        struct Node
+        {
+            SectionId                center;
+            std::vector<std::size_t> byStart; // Ascending
+            std::vector<std::size_t> byEnd;   // Descending
+            int                      left  { -1 };
+            int                      right { -1 };
+        };
+        
+        //==============================================================================================================
+        std::vector<Assignment>  assignments;
+        std::vector<SectionId>   starts;
+        std::vector<SectionId>   ends;
+        std::vector<std::size_t> byStart;
+        std::vector<Node>        nodes;
+        int                      root { -1 };
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        SectionId start(std::size_t index) const noexcept
+        {
+            return assignments[index].section.startNr;
+        }
+        
+        [[nodiscard]]
+        SectionId end(std::size_t index) const noexcept
+        {
+            return assignments[index].section.endNr;
+        }
+        
+        // Takes the assignments sorted by start; the center is the median start, so every level at least halves
+        // the assignments that are passed further down
+        [[nodiscard]]
+        int build(const std::vector<std::size_t> &sorted)
+        {
+            if (sorted.empty())
+            {
+                return -1;
+            }
+            
+            const SectionId center = start(sorted[sorted.size() / 2]);
+            
+            std::vector<std::size_t> left;
+            std::vector<std::size_t> right;
+            Node                     node { center, {}, {} };
+            
+            for (const std::size_t index : sorted)
+            {
+                if (end(index) < center)
+                {
+                    left.push_back(index);
+                }
+                else if (start(index) > center)
+                {
+                    right.push_back(index);
+                }
+                else
+                {
+                    node.byStart.push_back(index);
+                }
+            }
+            
+            node.byEnd = node.byStart;
+            std::sort(node.byEnd.begin(), node.byEnd.end(), [this](std::size_t l, std::size_t r)
+            {
+                return (end(l) > end(r));
+            });
+            
+            const auto node_index = static_cast<int>(nodes.size());
+            nodes.push_back(std::move(node));
+            
+            const int left_index  = build(left);
+            const int right_index = build(right);
+            
+            nodes[static_cast<std::size_t>(node_index)].left  = left_index;
+            nodes[static_cast<std::size_t>(node_index)].right = right_index;
+            
+            return node_index;
+        }
+    };
+    
+    //==================================================================================================================
+    // Turns a difference array into its running totals in place. The array is cut into one block per worker, each block
+    // sums itself up first and then does its own prefix sum, starting off with the totals of all the blocks before it.
+    template<class T>
+    void prefixSumParallel(std::vector<T> &values, aoc::ThreadPool &pool)
+    {
+        constexpr std::size_t minBlockSize = 1 << 16;
+        
+        const std::size_t block_count = std::clamp<std::size_t>(values.size() / minBlockSize, 1, pool.size());
+        const std::size_t block_size  = (values.size() + block_count - 1) / block_count;
+        
+        if (block_count == 1)
+        {
+            (void) std::partial_sum(values.begin(), values.end(), values.begin());
+            return;
+        }
+        
+        const auto block_range = [&values, block_size](std::size_t block)
+        {
+            const std::size_t first = block * block_size;
+            return std::make_pair(first, std::min(first + block_size, values.size()));
+        };
+        
+        std::vector<std::future<T>> totals;
+        totals.reserve(block_count);
+        
+        for (std::size_t block = 0; block < block_count; ++block)
+        {
+            const auto [first, last] = block_range(block);
+            
+            totals.push_back(pool.submit([&values, first = first, last = last]()
+            {
+                return std::accumulate(values.begin() + first, values.begin() + last, T{});
+            }));
+        }
+        
+        // Every block has to be summed up before any scan starts overwriting the values
+        std::vector<T> offsets(block_count);
+        T              offset {};
+        
+        for (std::size_t block = 0; block < block_count; ++block)
+        {
+            offsets[block] = offset;
+            offset        += totals[block].get();
+        }
+        
+        std::vector<std::future<void>> scans;
+        scans.reserve(block_count);
+        
+        for (std::size_t block = 0; block < block_count; ++block)
+        {
+            const auto [first, last] = block_range(block);
+            
+            scans.push_back(pool.submit([&values, first = first, last = last, offset = offsets[block]]()
+            {
+                T running = offset;
+                
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    running  += values[i];
+                    values[i] = running;
+                }
+            }));
+        }
+        
+        for (std::future<void> &scan : scans)
+        {
+            scan.get();
+        }
+    }
+    
+    //==================================================================================================================
+    // How many elves are assigned to every section, built from a difference array over all assignments.
+    // A dense profile keeps one count per section id between the lowest and highest assigned section, if the ids are
+    // too far apart for that, only the ids where the count changes are kept and each count spans up to the next one.
+    class SectionCoverage
+    {
+    public:
+        using Count = std::int32_t;
+        
+        //==============================================================================================================
+        /** The largest span of section ids that still gets a dense profile. */
+        static constexpr SectionId maxDenseSpan = SectionId(1) << 26;
+        
+        /** How many section ids a dense profile may have per assignment before it falls back to compression. */
+        static constexpr SectionId maxIdsPerAssignment = 64;
+        
+        //==============================================================================================================
+        SectionCoverage(const std::vector<Assignment> &assignments, aoc::ThreadPool &pool, bool forceCompression)
+        {
+            SectionId first = std::numeric_limits<SectionId>::max();
+            SectionId last  = std::numeric_limits<SectionId>::min();
+            
+            for (const Assignment &assignment : assignments)
+            {
+                if (assignment.section.startNr <= assignment.section.endNr)
+                {
+                    first = std::min(first, assignment.section.startNr);
+                    last  = std::max(last,  assignment.section.endNr);
+                }
+            }
+            
+            if (first > last)
+            {
+                return;
+            }
+            
+            // Computed in unsigned, as the span of two arbitrary ids doesn't fit into a SectionId
+            const auto span = static_cast<std::uint64_t>(last) - static_cast<std::uint64_t>(first) + 1;
+            const auto max_span = static_cast<std::uint64_t>(std::max<SectionId>(
+                static_cast<SectionId>(assignments.size()) * maxIdsPerAssignment, 1 << 16));
+            
+            if (!forceCompression && span <= static_cast<std::uint64_t>(maxDenseSpan) && span <= max_span)
+            {
+                buildDense(assignments, first, static_cast<std::size_t>(span), pool);
+            }
+            else
+            {
+                buildCompressed(assignments, pool);
+            }
+        }
+        
+        //==============================================================================================================
+        /** Gets how many elves are assigned to the given section. */
+        [[nodiscard]]
+        Count getCoverage(SectionId section) const noexcept
+        {
+            if (!compressed)
+            {
+                if (counts.empty() || section < firstSection
+                    || static_cast<std::uint64_t>(section - firstSection) >= counts.size())
+                {
+                    return 0;
+                }
+                
+                return counts[static_cast<std::size_t>(section - firstSection)];
+            }
+            
+            const auto it = std::upper_bound(coordinates.begin(), coordinates.end(), section);
+            return (it == coordinates.begin() ? 0 : counts[static_cast<std::size_t>(it - coordinates.begin() - 1)]);
+        }
+        
+        /**
+            Calls callback(first, last, count) for every run of consecutive sections sharing the same count,
+            from the lowest to the highest assigned section.
+         */
+        template<class Fn>
+        void forEachRun(Fn &&callback) const
+        {
+            std::size_t i = 0;
+            
+            while (i < runCount())
+            {
+                const Count     count = counts[i];
+                const SectionId first = runStart(i);
+                
+                while (i < runCount() && counts[i] == count)
+                {
+                    (void) ++i;
+                }
+                
+                callback(first, runStart(i) - 1, count);
+            }
+        }
+        
+        /** Counts the section ids that are assigned to at least the given amount of elves. */
+        [[nodiscard]]
+        std::uint64_t countSectionsCoveredBy(Count minimum) const
+        {
+            std::uint64_t result = 0;
+            
+            forEachRun([&result, minimum](SectionId first, SectionId last, Count count)
+            {
+                if (count >= minimum)
+                {
+                    result += static_cast<std::uint64_t>(last - first) + 1;
+                }
+            });
+            
+            return result;
+        }
+        
+        //==============================================================================================================
+        /** Gets the highest amount of elves assigned to a single section. */
+        [[nodiscard]]
+        Count getMaximum() const noexcept
+        {
+            return (counts.empty() ? 0 : *std::max_element(counts.begin(), counts.end()));
+        }
+        
+        /** Whether the profile was built over compressed coordinates. */
+        [[nodiscard]]
+        bool isCompressed() const noexcept
+        {
+            return compressed;
+        }
+        
+    private:
+        // Dense: counts[i] is the count of section firstSection + i
+        // Compressed: counts[i] is the count of all sections from coordinates[i] up to coordinates[i + 1]
+        std::vector<SectionId> coordinates;
+        std::vector<Count>     counts;
+        SectionId              firstSection { 0 };
+        bool                   compressed   { false };
+        
+        //==============================================================================================================
+        // The last coordinate only marks where the last run ends and has no count of its own
+        [[nodiscard]]
+        std::size_t runCount() const noexcept
+        {
+            return (compressed ? counts.size() - 1 : counts.size());
+        }
+        
+        [[nodiscard]]
+        SectionId runStart(std::size_t run) const noexcept
+        {
+            return (compressed ? coordinates[run] : firstSection + static_cast<SectionId>(run));
+        }
+        
+        //==============================================================================================================
+        void buildDense(const std::vector<Assignment> &assignments, SectionId first, std::size_t span,
+                        aoc::ThreadPool &pool)
+        {
+            firstSection = first;
+            counts.assign(span + 1, 0);
+            
+            for (const Assignment &assignment : assignments)
+            {
+                if (assignment.section.startNr <= assignment.section.endNr)
+                {
+                    (void) ++counts[static_cast<std::size_t>(assignment.section.startNr - first)];
+                    (void) --counts[static_cast<std::size_t>(assignment.section.endNr   - first) + 1];
+                }
+            }
+            
+            // The trailing slot only takes the decrements of the highest section, it is always 0 after the prefix sum
+            counts.pop_back();
+            prefixSumParallel(counts, pool);
+        }
+        
+        void buildCompressed(const std::vector<Assignment> &assignments, aoc::ThreadPool &pool)
+        {
+            compressed = true;
+            coordinates.reserve(assignments.size() * 2);
+            
+            for (const Assignment &assignment : assignments)
+            {
+                if (assignment.section.startNr <= assignment.section.endNr)
+                {
+                    coordinates.push_back(assignment.section.startNr);
+                    coordinates.push_back(assignment.section.endNr + 1);
+                }
+            }
+            
+            std::sort(coordinates.begin(), coordinates.end());
+            coordinates.erase(std::unique(coordinates.begin(), coordinates.end()), coordinates.end());
+            counts.assign(coordinates.size(), 0);
+            
+            const auto index_of = [this](SectionId section)
+            {
+                return static_cast<std::size_t>(std::lower_bound(coordinates.begin(), coordinates.end(), section)
+                                                - coordinates.begin());
+            };
+            
+            for (const Assignment &assignment : assignments)
+            {
+                if (assignment.section.startNr <= assignment.section.endNr)
+                {
+                    (void) ++counts[index_of(assignment.section.startNr)];
+                    (void) --counts[index_of(assignment.section.endNr + 1)];
+                }
+            }
+            
+            prefixSumParallel(counts, pool);
+        }
+    };
+    
+    //==================================================================================================================
+    // The linear scans the index is measured against
+    [[nodiscard]]
+    std::size_t countCoveringBruteForce(const std::vector<Assignment> &assignments, SectionId section) noexcept
+    {
+        std::size_t count = 0;
+        
+        for (const Assignment &assignment : assignments)
+        {
+            count += (assignment.section.startNr <= section && assignment.section.endNr >= section);
+        }
+        
+        return count;
+    }
+    
+    [[nodiscard]]
+    std::size_t countOverlappingBruteForce(const std::vector<Assignment> &assignments,
+                                           SectionId                     first,
+                                           SectionId                     last) noexcept
+    {
+        std::size_t count = 0;
+        
+        for (const Assignment &assignment : assignments)
+        {
+            count += (assignment.section.startNr <= last && assignment.section.endNr >= first);
+        }
+        
+        return count;
+    }
+    
+    [[nodiscard]]
+    std::size_t countConflictsBruteForce(const std::vector<Assignment> &assignments) noexcept
+    {
+        std::size_t count = 0;
+        
+        for (std::size_t i = 0; i < assignments.size(); ++i)
+        {
+            for (std::size_t j = i + 1; j < assignments.size(); ++j)
+            {
+                const Section &a = assignments[i].section;
+                const Section &b = assignments[j].section;
+                
+                count += (assignments[i].line != assignments[j].line && a.startNr <= b.endNr && b.startNr <= a.endNr);
+            }
+        }
+        
+        return count;
+    }
+    
+    template<class Fn>
+    [[nodiscard]]
+    double measureMilliseconds(Fn &&function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    void runIndexBenchmark()
+    {
+        std::mt19937_64 generator(2022);
+        
+        const auto make_roster = [&generator](std::size_t lines, SectionId maxSection, SectionId maxLength)
+        {
+            std::uniform_int_distribution<SectionId> section_distribution(1, maxSection);
+            std::uniform_int_distribution<SectionId> length_distribution (0, maxLength);
+            std::vector<Assignment>                  roster;
+            
+            for (std::size_t line = 1; line <= lines; ++line)
+            {
+                for (int elf = 1; elf <= 2; ++elf)
+                {
+                    const SectionId start = section_distribution(generator);
+                    roster.push_back({ { start, start + length_distribution(generator) }, line, elf });
+                }
+            }
+            
+            return roster;
+        };
+        
+        constexpr std::size_t queryCount = 200;
+        
+        const std::vector<Assignment> roster = make_roster(500'000, 10'000'000, 1'000);
+        std::vector<SectionId>        queries;
+        
+        std::uniform_int_distribution<SectionId> query_distribution(1, 10'000'000);
+        std::generate_n(std::back_inserter(queries), queryCount, [&]() { return query_distribution(generator); });
+        
+        std::optional<SectionIndex> index;
+        const double build_time = measureMilliseconds([&]() { index.emplace(roster); });
+        
+        std::size_t index_cover = 0;
+        std::size_t brute_cover = 0;
+        std::size_t index_range = 0;
+        std::size_t brute_range = 0;
+        
+        const double index_cover_time = measureMilliseconds([&]()
+        {
+            for (const SectionId query : queries)
+            {
+                index->forEachCovering(query, [&index_cover](const Assignment&) { (void) ++index_cover; });
+            }
+        });
+        
+        const double brute_cover_time = measureMilliseconds([&]()
+        {
+            for (const SectionId query : queries)
+            {
+                brute_cover += countCoveringBruteForce(roster, query);
+            }
+        });
+        
+        const double index_range_time = measureMilliseconds([&]()
+        {
+            for (const SectionId query : queries)
+            {
+                index_range += index->countOverlapping(query, query + 5'000);
+            }
+        });
+        
+        const double brute_range_time = measureMilliseconds([&]()
+        {
+            for (const SectionId query : queries)
+            {
+                brute_range += countOverlappingBruteForce(roster, query, query + 5'000);
+            }
+        });
+        
+        const std::vector<Assignment> small_roster = make_roster(5'000, 1'000'000, 1'000);
+        const SectionIndex            small_index(small_roster);
+        
+        std::size_t index_conflicts = 0;
+        std::size_t brute_conflicts = 0;
+        
+        const double index_conflict_time = measureMilliseconds([&]()
+        {
+            small_index.forEachConflict([&index_conflicts](const Assignment&, const Assignment&)
+            {
+                (void) ++index_conflicts;
+            });
+        });
+        
+        const double brute_conflict_time = measureMilliseconds([&]()
+        {
+            brute_conflicts = countConflictsBruteForce(small_roster);
+        });
+        
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Index over " << roster.size() << " assignments built in " << build_time << " ms\n"
+                  << queryCount << " cover queries:   index " << index_cover_time << " ms, brute force "
+                      << brute_cover_time << " ms" << (index_cover == brute_cover ? "" : " (MISMATCH)") << '\n'
+                  << queryCount << " overlap counts:  index " << index_range_time << " ms, brute force "
+                      << brute_range_time << " ms" << (index_range == brute_range ? "" : " (MISMATCH)") << '\n'
+                  << "Conflicts of " << small_roster.size() << " assignments: index " << index_conflict_time
+                      << " ms, brute force " << brute_conflict_time << " ms"
+                      << (index_conflicts == brute_conflicts ? "" : " (MISMATCH)") << '\n';
+    }
 }
 //======================================================================================================================
 // endregion Namespace
 //**********************************************************************************************************************
 // region Main
 //======================================================================================================================
-int main()
+int main(int argc, char **argv)
 {
-    std::fstream input(INPUT_FILE);
+    // Usage: day_4 [--simd] [--validate] [--cover X] [--overlap A B] [--conflicts] [--bench]
+    //             [--coverage K] [--compress] [--threads N] [input file]
+    bool                     use_simd     = false;
+    bool                     validate     = false;
+    bool                     conflicts    = false;
+    bool                     compress     = false;
+    std::size_t              thread_count = 0;
+    std::optional<SectionId> cover;
+    std::optional<Section>   overlap;
+    std::optional<int>       coverage;
+    const char               *input_url = INPUT_FILE;
     
-    if (!input.is_open())
+    for (int i = 1; i < argc; ++i)
     {
-        return 1;
+        const std::string_view arg(argv[i]);
+        
+        if (arg == "--simd")
+        {
+            use_simd = true;
+        }
+        else if (arg == "--validate")
+        {
+            validate = true;
+        }
+        else if (arg == "--cover" && (i + 1) < argc)
+        {
+            cover = std::strtoll(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--overlap" && (i + 2) < argc)
+        {
+            overlap = Section{ std::strtoll(argv[i + 1], nullptr, 10), std::strtoll(argv[i + 2], nullptr, 10) };
+            i += 2;
+        }
+        else if (arg == "--conflicts")
+        {
+            conflicts = true;
+        }
+        else if (arg == "--coverage" && (i + 1) < argc)
+        {
+            coverage = std::atoi(argv[++i]);
+        }
+        else if (arg == "--compress")
+        {
+            compress = true;
+        }
+        else if (arg == "--threads" && (i + 1) < argc)
+        {
+            thread_count = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--bench")
+        {
+            ::runIndexBenchmark();
+            return 0;
+        }
+        else
+        {
+            input_url = argv[i];
+        }
     }
     
-    std::string line;
-    int         contained_count = 0;
-    int         intersect_count = 0;
-    
-    while (std::getline(input, line))
+    if (cover.has_value() || overlap.has_value() || conflicts || coverage.has_value())
     {
-        const ::ElfPair pair = ::ElfPair::fromString(line);
+        ::SectionColumns<SectionId> columns;
+        
+        try
+        {
+            const aoc::MappedFile file(input_url);
+            (void) ::parseColumns(file.begin(), file.end(), columns);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cout << "Exception caught: " << ex.what();
+            return 1;
+        }
+        
+        std::vector<::Assignment> assignments = ::toAssignments(columns);
+        
+        if (coverage.has_value())
+        {
+            aoc::ThreadPool         pool(thread_count);
+            const ::SectionCoverage profile(assignments, pool, compress);
+            std::size_t             printed = 0;
+            
+            profile.forEachRun([&printed, &coverage](SectionId first, SectionId last, ::SectionCoverage::Count count)
+            {
+                if (count >= *coverage && printed++ < 20)
+                {
+                    std::cout << "Sections " << first << '-' << last << ": " << count << " elves\n";
+                }
+            });
+            
+            std::cout << profile.countSectionsCoveredBy(*coverage) << " sections are covered by at least "
+                      << *coverage << " elves (" << (profile.isCompressed() ? "compressed" : "dense")
+                      << " profile, at most " << profile.getMaximum() << " elves on one section)\n";
+            
+            if (!cover.has_value() && !overlap.has_value() && !conflicts)
+            {
+                return 0;
+            }
+        }
+        
+        const ::SectionIndex index(std::move(assignments));
         
-        if (pair.containsContained())
+        if (cover.has_value())
         {
-            (void) ++contained_count;
+            std::size_t count = 0;
+            
+            index.forEachCovering(*cover, [&count](const ::Assignment &assignment)
+            {
+                if (count++ < 20)
+                {
+                    std::cout << "Line " << assignment.line << ", elf " << assignment.elf << ": "
+                              << assignment.section.startNr << '-' << assignment.section.endNr << '\n';
+                }
+            });
+            
+            std::cout << count << " assignments cover section " << *cover << '\n';
         }
         
-        if (pair.intersects())
+        if (overlap.has_value())
         {
-            (void) ++intersect_count;
+            std::cout << index.countOverlapping(overlap->startNr, overlap->endNr) << " assignments overlap sections "
+                      << overlap->startNr << '-' << overlap->endNr << '\n';
+        }
+        
+        if (conflicts)
+        {
+            std::size_t count = 0;
+            
+            index.forEachConflict([&count](const ::Assignment &first, const ::Assignment &second)
+            {
+                if (count++ < 20)
+                {
+                    std::cout << "Line " << first.line << ", elf " << first.elf << ": "
+                              << first.section.startNr << '-' << first.section.endNr << " conflicts with line "
+                              << second.line << ", elf " << second.elf << ": "
+                              << second.section.startNr << '-' << second.section.endNr << '\n';
+                }
+            });
+            
+            std::cout << count << " pairs of assignments from different lines conflict\n";
         }
+        
+        return 0;
+    }
+    
+    ::PairCounts counts {};
+    
+    if (!(use_simd ? ::countPairs(input_url, counts) : ::countPairsReference(input_url, counts)))
+    {
+        return 1;
+    }
+    
+    std::cout << "In "       << counts.contained    << " pairs there is a significant containment, reporter states.\n";
+    std::cout << "At least " << counts.intersecting << " of the pairs intersect section-wise, not good dawg.\n";
+    
+    if (validate && use_simd)
+    {
+        ::PairCounts reference {};
+        const bool   matches = (::countPairsReference(input_url, reference)
+                                && reference.contained    == counts.contained
+                                && reference.intersecting == counts.intersecting);
+        
+        std::cout << "Validation against the reference path " << (matches ? "passed" : "FAILED") << '\n';
+        return (matches ? 0 : 1);
     }
     
-    std::cout << "In "       << contained_count << " pairs there is a significant containment, reporter states.\n";
-    std::cout << "At least " << intersect_count << " of the pairs intersect section-wise, not good dawg.\n";
     return 0;
 }
 //======================================================================================================================
@@ -15,17 +15,35 @@
     ====================================================================================================================
  */
 
+#include "../aoc_mapped_file.h"
+#include "../aoc_thread_pool.h"
 #include "../aoc_utility.h"
 
-#include <array>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
 #include <iostream>
-#include <queue>
+#include <iterator>
+#include <limits>
 #include <list>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
 #include <sstream>
-#include <stack>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -54,17 +72,16 @@ namespace
     class IcmsDocument
     {
     public:
-        class Stack;
-        
-        /** Contains the information about our crates. */
+        /** Contains the information about our crates, which stack they are on is told by the stack holding them. */
         struct Crate
         {
-            Stack *owner { nullptr };
-            char  id     {       0 };
+            char id { 0 };
         };
         
+        static_assert(sizeof(Crate) == 1, "crates are stored as plain bytes");
+        
         /** A pile of containers, nothing more... nothing less. */
-        class Stack : private std::stack<Crate, std::list<Crate>>
+        class Stack
         {
         public:
             explicit Stack(std::string parId) noexcept
@@ -72,9 +89,8 @@ namespace
             {}
             
             Stack(std::string parId, std::initializer_list<Crate> parCrates)
-                noexcept(std::is_nothrow_move_constructible_v<std::list<Crate>>)
-                : std::stack<Crate, std::list<Crate>>(parCrates),
-                  id(std::move(parId))
+                : crates(parCrates),
+                  id    (std::move(parId))
             {}
             
             //==========================================================================================================
@@ -85,65 +101,78 @@ namespace
                 return id;
             }
             
+            /** Gets the number of crates on the stack. */
+            [[nodiscard]]
+            std::size_t size() const noexcept
+            {
+                return crates.size();
+            }
+            
+            /** Makes room for the given number of crates. */
+            void reserve(std::size_t capacity)
+            {
+                crates.reserve(capacity);
+            }
+            
             //==========================================================================================================
             [[nodiscard]]
             const Crate& topCrate() const noexcept
             {
-                return top();
+                return crates.back();
             }
             
             /** Place a crate on the top. */
             void putOn(Crate crate)
             {
-                crate.owner = this;
-                push(crate);
+                crates.push_back(crate);
             }
             
-            /** Put on a list of crates. */
-            void putOn(const std::vector<Crate> &crates)
+            /** Place crates with the given ids, from bottom to top. */
+            void putOn(std::string_view ids)
             {
-                for (const Crate &crate : crates)
+                for (const char crateId : ids)
                 {
-                    putOn(crate);
+                    crates.push_back(Crate{ crateId });
                 }
             }
             
             /** Take a crate from the top. */
             Crate takeOff()
             {
-                Crate crate = top();
-                crate.owner = nullptr;
-                pop();
+                const Crate crate = crates.back();
+                crates.pop_back();
                 
                 return crate;
             }
             
-            /** Take a number of crates from the top. */
-            std::vector<Crate> takeOff(int amount)
+            /** Take a number of crates from the top one by one and put them onto the target, reversing their order. */
+            void takeOff(int amount, Stack &target)
             {
-                std::vector<Crate> crates;
-                crates.reserve(amount);
+                const auto first = crates.end() - amount;
                 
-                for (amount -= 1; amount >= 0; --amount)
+                if (&target == this)
                 {
-                    crates.emplace_back(takeOff());
+                    std::reverse(first, crates.end());
+                    return;
                 }
                 
-                return crates;
+                (void) target.crates.insert(target.crates.end(), std::make_reverse_iterator(crates.end()),
+                                            std::make_reverse_iterator(first));
+                (void) crates.erase(first, crates.end());
             }
             
-            /** Take a number of crates from the top. */
-            std::vector<Crate> liftOff(int amount)
+            /** Take a number of crates from the top all at once and put them onto the target, keeping their order. */
+            void liftOff(int amount, Stack &target)
             {
-                std::vector<Crate> crates;
-                crates.resize(amount);
-                
-                for (amount -= 1; amount >= 0; --amount)
+                if (&target == this)
                 {
-                    crates[amount] = takeOff();
+                    return;
                 }
                 
-                return crates;
+                const auto first = crates.end() - amount;
+                
+                (void) target.crates.insert(target.crates.end(), first, crates.end());
+                (void) crates.erase(first, crates.end());
             }
             
             //==========================================================================================================
@@ -151,13 +180,13 @@ namespace
             [[nodiscard]]
             const Crate &readCrate(int index) const noexcept
             {
-                auto it = c.begin();
-                std::advance(it, index);
-                return *it;
+                return crates[static_cast<std::size_t>(index)];
             }
             
         private:
-            std::string id;
+            // From bottom to top
+            std::vector<Crate> crates;
+            std::string        id;
         };
         
         struct Instruction
@@ -191,84 +220,180 @@ namespace
             return stacks;
         }
         
+        const std::vector<Stack>& getStacks() const noexcept
+        {
+            return stacks;
+        }
+        
         const std::vector<Instruction>& getInstructions() const noexcept
         {
-            return instructions;
+            static const std::vector<Instruction> no_instructions;
+            return (instructions ? *instructions : no_instructions);
+        }
+        
+        //==============================================================================================================
+        /**
+            Creates an independent copy of the stacks to run another simulation on.
+            The instructions are never changed, so the copy shares them with this document.
+         */
+        [[nodiscard]]
+        IcmsDocument snapshot() const
+        {
+            return *this;
         }
         
     private:
         // It got late, I don't care
         friend class IcmsParser;
+        friend class IcmsBinaryFormat;
         
         //==============================================================================================================
-        std::vector<Stack>       stacks;
-        std::vector<Instruction> instructions;
-        bool                     parsed { false };
+        std::vector<Stack>                              stacks;
+        std::shared_ptr<const std::vector<Instruction>> instructions;
+        bool                                            parsed { false };
         
         //==============================================================================================================
-        IcmsDocument(std::vector<Stack> parStacks, std::vector<Instruction> parInstructions) noexcept
+        IcmsDocument(std::vector<Stack> parStacks, std::vector<Instruction> parInstructions)
             : stacks      (std::move(parStacks)),
-              instructions(std::move(parInstructions)),
+              instructions(std::make_shared<const std::vector<Instruction>>(std::move(parInstructions))),
               parsed      (true)
         {}
     };
     
+    // Reads ICMS documents straight out of the mapped file, tokens are just views into it.
+    // Apart from the stacks and instructions that make up the document, nothing is allocated along the way.
     class IcmsParser
     {
     public:
         [[nodiscard]]
         static IcmsDocument parseDocument(const char *file)
         {
-            IcmsParser parser(file);
-            auto it = parser.lines.begin();
-            std::vector<IcmsDocument::Stack>       stacks       = parser.parseSchematic   (it);
-            std::vector<IcmsDocument::Instruction> instructions = parser.parseInstructions(it);
+            const aoc::MappedFile input(file);
+            IcmsParser            parser(input.view());
+            
+            std::vector<IcmsDocument::Stack>       stacks       = parser.parseSchematic();
+            std::vector<IcmsDocument::Instruction> instructions = parser.parseInstructions(stacks.size());
             
             return { std::move(stacks), std::move(instructions) };
         }
         
-    private:
-        struct Token
-        {
-            std::string content;
-            int         line;
-            int         column;
-            int         length;
-        };
-        
-        struct InstructionToken
-        {
-            std::string id;
-            std::string value;
-        };
-        
-        //==============================================================================================================
-        std::vector<std::string> lines;
-        
-        //==============================================================================================================
-        [[nodiscard]]
-        static std::vector<std::string> readLines(const std::string &file)
+        /**
+            Parses the schematic and hands the stacks to onSchematic, then reads the instructions chunk by chunk and
+            hands each one to onInstruction as soon as it is decoded. Only the schematic and the current chunk are held
+            in memory, no matter how many instructions follow.
+         */
+        template<class SchematicFn, class InstructionFn>
+        static void streamDocument(const char *file, SchematicFn &&onSchematic, InstructionFn &&onInstruction)
         {
-            std::fstream input(file);
+            constexpr std::size_t chunkSize = 1 << 16;
+            
+            std::ifstream stream(file, std::ios::binary);
+            
+            if (!stream.is_open())
+            {
+                throw std::runtime_error("File '" + std::string(file) + "' not found");
+            }
+            
+            std::string buffer;
+            
+            const auto read_chunk = [&stream, &buffer]()
+            {
+                const std::size_t old_size = buffer.size();
+                buffer.resize(old_size + chunkSize);
+                (void) stream.read(buffer.data() + old_size, static_cast<std::streamsize>(chunkSize));
+                buffer.resize(old_size + static_cast<std::size_t>(stream.gcount()));
+                
+                return (stream.gcount() > 0);
+            };
             
-            if (!input.is_open())
+            // Everything up to and including the id line is the schematic
+            std::size_t schematic_end = std::string::npos;
+            
+            for (std::size_t start = 0; schematic_end == std::string::npos;)
             {
-                throw std::runtime_error("File '" + file + "' not found");
+                const std::size_t newline = buffer.find('\n', start);
+                
+                if (newline == std::string::npos)
+                {
+                    if (!read_chunk())
+                    {
+                        schematic_end = buffer.size();
+                    }
+                    
+                    continue;
+                }
+                
+                const std::string_view line(buffer.data() + start, newline - start);
+                const std::size_t      first = line.find_first_not_of(" \t\r\v\f");
+                
+                if (first != std::string_view::npos && aoc::isDigit(line[first]))
+                {
+                    schematic_end = newline + 1;
+                }
+                
+                start = newline + 1;
             }
             
-            std::string              line;
-            std::vector<std::string> lines;
-            lines.reserve(1024);
+            IcmsParser parser(std::string_view(buffer).substr(0, schematic_end));
+            std::vector<IcmsDocument::Stack> stacks = parser.parseSchematic();
+            
+            const std::size_t stack_count = stacks.size();
+            int               line_number = parser.lineNumber;
             
-            while (std::getline(input, line))
+            onSchematic(std::move(stacks));
+            (void) buffer.erase(0, schematic_end);
+            
+            const auto handle_line = [&](std::string_view line)
+            {
+                (void) ++line_number;
+                
+                if (!aoc::isEmptyLine(line))
+                {
+                    onInstruction(parseInstruction(line, line_number, stack_count));
+                }
+            };
+            
+            for (std::size_t start = 0;;)
             {
-                lines.emplace_back(std::move(line));
+                const std::size_t newline = buffer.find('\n', start);
+                
+                if (newline == std::string::npos)
+                {
+                    // Keep the partial line at the front and append the next chunk behind it
+                    (void) buffer.erase(0, start);
+                    start = 0;
+                    
+                    if (!read_chunk())
+                    {
+                        break;
+                    }
+                    
+                    continue;
+                }
+                
+                handle_line(std::string_view(buffer.data() + start, newline - start));
+                start = newline + 1;
             }
             
-            lines.shrink_to_fit();
-            return lines;
+            if (!buffer.empty())
+            {
+                handle_line(buffer);
+            }
         }
         
+    private:
+        struct Token
+        {
+            std::string_view content;
+            int              line;
+            int              column;
+        };
+        
+        //==============================================================================================================
+        std::string_view input;
+        std::size_t      position   { 0 };
+        int              lineNumber { 0 };
+        
         //==============================================================================================================
         static void parseError(const std::string &message, int lineNumber)
         {
@@ -277,308 +402,1526 @@ namespace
             throw std::runtime_error(ss.str());
         }
         
+        static void floatingCrateError(const Token &crate)
+        {
+            parseError("encountered floating or excess crate '[" + std::string(crate.content)
+                           + "]' at column " + std::to_string(crate.column + 1),
+                       crate.line);
+        }
+        
         //==============================================================================================================
-        static void readIdTokens(std::vector<Token> &tokens,
-                                 const std::string  &line,
-                                 std::size_t        startIndex,
-                                 int                lineNumber)
+        // Reads the next stack id of the id line, starting at pos
+        [[nodiscard]]
+        static bool nextIdToken(std::string_view line, std::size_t &pos, int lineNumber, Token &token)
         {
-            for (auto it = (line.begin() + static_cast<int>(startIndex)); it != line.end(); ++it)
+            for (; pos < line.size(); ++pos)
             {
-                const char c = *it;
+                const char c = line[pos];
                 
                 if (aoc::isWhitespace(c))
                 {
                     continue;
                 }
                 
-                if (aoc::isIdentifier(c))
+                if (!aoc::isIdentifier(c))
                 {
-                    const int column = static_cast<int>(std::distance(line.begin(), it));
-                    
-                    std::array<char, 512> id_buffer { c };
-                    auto id_it = id_buffer.begin();
-    
-                    (void) ++it;
-                    
-                    for (; it != line.end(); ++it)
-                    {
-                        const char n = *it;
-                        
-                        if (aoc::isWhitespace(n))
-                        {
-                            break;
-                        }
-                        
-                        if (aoc::isIdentifier(n))
-                        {
-                            *(++id_it) = n;
-                            continue;
-                        }
-                    }
-                    
-                    const int id_len = static_cast<int>(std::strlen(id_buffer.data()));
-                    (void) tokens.emplace_back(Token{ id_buffer.data(), lineNumber, column, id_len });
-                    
-                    if (it == line.end())
-                    {
-                        break;
-                    }
-                    
-                    continue;
+                    parseError(std::string("'") + c + "' is not a valid starting token", lineNumber);
+                }
+                
+                const std::size_t start = pos;
+                
+                while (pos < line.size() && aoc::isIdentifier(line[pos]))
+                {
+                    (void) ++pos;
+                }
+                
+                if (pos < line.size() && !aoc::isWhitespace(line[pos]))
+                {
+                    parseError(std::string("'") + line[pos] + "' is not a valid id character", lineNumber);
                 }
                 
-                parseError(std::string("'") + c + "' is not a valid starting token", lineNumber);
+                token = { line.substr(start, pos - start), lineNumber, static_cast<int>(start) };
+                return true;
             }
+            
+            return false;
         }
         
-        static void readCrateTokens(std::queue<Token> &tokens,
-                                    const std::string &line,
-                                    std::size_t       startIndex,
-                                    int               lineNumber)
+        // Reads the next crate of a crate line, starting at pos
+        [[nodiscard]]
+        static bool nextCrateToken(std::string_view line, std::size_t &pos, int lineNumber, Token &token)
         {
-            for (auto it = (line.begin() + static_cast<int>(startIndex)); it != line.end(); ++it)
+            for (; pos < line.size(); ++pos)
             {
-                const char c = *it;
+                const char c = line[pos];
                 
                 if (aoc::isWhitespace(c))
                 {
                     continue;
                 }
                 
-                if (c == '[')
+                if (c != '[')
                 {
-                    if (aoc::peekNext(it, line.end()) == 0)
-                    {
-                        parseError("unterminated crate definition", lineNumber);
-                    }
-                    
-                    (void) ++it;
-                    
-                    if (aoc::peekNext(it, line.end()) != ']')
-                    {
-                        parseError("unterminated crate definition", lineNumber);
-                    }
-                    
-                    (void) tokens.emplace(Token {
-                        std::string{ *it },
-                        lineNumber,
-                        static_cast<int>(std::distance(line.begin(), it)),
-                        1
-                    });
-                    
-                    (void) ++it;
-                    
-                    continue;
+                    parseError(std::string("'") + c + "' is not a valid starting token", lineNumber);
                 }
                 
-                parseError(std::string("'") + c + "' is not a valid starting token", lineNumber);
+                if ((pos + 2) >= line.size() || line[pos + 2] != ']')
+                {
+                    parseError("unterminated crate definition", lineNumber);
+                }
+                
+                token = { line.substr(pos + 1, 1), lineNumber, static_cast<int>(pos + 1) };
+                pos  += 3;
+                return true;
             }
+            
+            return false;
         }
         
         //==============================================================================================================
-        explicit IcmsParser(const std::string &documentFile)
-            : lines(readLines(documentFile))
+        explicit IcmsParser(std::string_view parInput) noexcept
+            : input(parInput)
         {}
         
         //==============================================================================================================
         [[nodiscard]]
-        std::vector<IcmsDocument::Stack> parseSchematic(decltype(lines.begin()) &it)
+        bool nextLine(std::string_view &line) noexcept
+        {
+            if (position >= input.size())
+            {
+                return false;
+            }
+            
+            const std::size_t end = std::min(input.find('\n', position), input.size());
+            
+            line     = input.substr(position, end - position);
+            position = end + 1;
+            (void) ++lineNumber;
+            
+            return true;
+        }
+        
+        //==============================================================================================================
+        // The crate lines are only skimmed until the id line is found, then they are read again from the bottom up,
+        // so every crate can directly be put onto its stack
+        [[nodiscard]]
+        std::vector<IcmsDocument::Stack> parseSchematic()
         {
-            std::vector<std::queue<Token>> tokens_crate;
-            std::vector<Token>             tokens_id;
+            const std::size_t schematic_start = position;
+            std::string_view  id_line;
+            std::string_view  line;
             
-            for (; it != lines.end(); ++it)
+            while (id_line.empty() && nextLine(line))
             {
-                const std::string &line    = *it;
-                const int         line_num = static_cast<int>(std::distance(lines.begin(), it)) + 1;
-                
                 if (aoc::isEmptyLine(line))
                 {
                     continue;
                 }
                 
-                for (auto c_it = line.begin(); c_it != line.end(); ++c_it)
+                const char c = line[line.find_first_not_of(" \t\r\v\f")];
+                
+                if (aoc::isDigit(c))
                 {
-                    const char c = *c_it;
-                    
-                    if (aoc::isWhitespace(c))
-                    {
-                        continue;
-                    }
-                    
-                    if (c == '[')
-                    {
-                        readCrateTokens(tokens_crate.emplace_back(), line, std::distance(line.begin(), c_it), line_num);
-                        break;
-                    }
-                    
-                    if (aoc::isDigit(c))
-                    {
-                        readIdTokens(tokens_id, line, std::distance(line.begin(), c_it), line_num);
-                        break;
-                    }
-                    
-                    parseError(std::string("'") + c + "' is not a valid starting token", line_num);
+                    id_line = line;
                 }
-                
-                if (!tokens_id.empty())
+                else if (c != '[')
                 {
-                    (void) ++it;
-                    break;
+                    parseError(std::string("'") + c + "' is not a valid starting token", lineNumber);
                 }
             }
             
+            if (id_line.empty())
+            {
+                parseError("missing the line of stack ids", lineNumber);
+            }
+            
+            const int   id_line_number = lineNumber;
+            std::size_t stack_count    = 0;
+            Token       id {};
+            
+            for (std::size_t pos = 0; nextIdToken(id_line, pos, id_line_number, id);)
+            {
+                (void) ++stack_count;
+            }
+            
             std::vector<IcmsDocument::Stack> stacks;
+            stacks.reserve(stack_count);
+            
+            for (std::size_t pos = 0; nextIdToken(id_line, pos, id_line_number, id);)
+            {
+                (void) stacks.emplace_back(std::string(id.content));
+            }
             
-            for (const auto &id : tokens_id)
+            const char *const first = input.data() + schematic_start;
+            const char       *next  = id_line.data();
+            int               row   = 0;
+            
+            for (int line_num = id_line_number - 1; next > first; --line_num)
             {
-                IcmsDocument::Stack stack(id.content);
+                const char *const end   = next - 1;
+                const char       *begin = end;
                 
-                for (auto list_it = tokens_crate.rbegin(); list_it != tokens_crate.rend(); ++list_it)
+                while (begin > first && *(begin - 1) != '\n')
                 {
-                    std::queue<Token> &tokens = *list_it;
-                    
-                    if (tokens.empty())
-                    {
-                        break;
-                    }
-                    
-                    const Token crate = tokens.front();
-                    
-                    if (crate.column < id.column)
+                    (void) --begin;
+                }
+                
+                next = begin;
+                
+                const std::string_view crate_line(begin, static_cast<std::size_t>(end - begin));
+                
+                if (aoc::isEmptyLine(crate_line))
+                {
+                    continue;
+                }
+                
+                // Crates and ids are both ordered by column, so the id line is walked along with the crates
+                std::size_t id_pos  = 0;
+                std::size_t stack   = 0;
+                bool        has_id  = nextIdToken(id_line, id_pos, id_line_number, id);
+                Token       crate {};
+                
+                for (std::size_t pos = 0; nextCrateToken(crate_line, pos, line_num, crate);)
+                {
+                    while (has_id && crate.column >= (id.column + static_cast<int>(id.content.size())))
                     {
-                        parseError("encountered floating or excess crate '[" + crate.content
-                                       + "]' at column " + std::to_string(crate.column + 1),
-                                   crate.line);
+                        has_id = nextIdToken(id_line, id_pos, id_line_number, id);
+                        (void) ++stack;
                     }
                     
-                    if (crate.column >= id.column && crate.column < (id.column + id.length))
+                    if (!has_id || crate.column < id.column || stacks[stack].size() != static_cast<std::size_t>(row))
                     {
-                        stack.putOn(IcmsDocument::Crate{ &stack, crate.content[0] });
-                        tokens.pop();
-
-                        continue;
+                        floatingCrateError(crate);
                     }
                     
-                    break;
+                    stacks[stack].putOn(IcmsDocument::Crate{ crate.content[0] });
                 }
                 
-                (void) stacks.emplace_back(std::move(stack));
+                (void) ++row;
             }
             
-            for (auto list_it = tokens_crate.rbegin(); list_it != tokens_crate.rend(); ++list_it)
+            return stacks;
+        }
+        
+        [[nodiscard]]
+        std::vector<IcmsDocument::Instruction> parseInstructions(std::size_t stackCount)
+        {
+            std::vector<IcmsDocument::Instruction> instructions;
+            instructions.reserve(static_cast<std::size_t>(std::count(input.begin() + static_cast<std::ptrdiff_t>(
+                std::min(position, input.size())), input.end(), '\n')) + 1);
+            
+            for (std::string_view line; nextLine(line);)
             {
-                const std::queue<Token> &tokens = *list_it;
-                
-                if (!tokens.empty())
+                if (!aoc::isEmptyLine(line))
                 {
-                    const Token crate = tokens.front();
-                    parseError("encountered floating or excess crate '[" + crate.content
-                                   + "]' at column " + std::to_string(crate.column + 1),
-                               crate.line);
+                    instructions.push_back(parseInstruction(line, lineNumber, stackCount));
                 }
             }
             
-            return stacks;
+            return instructions;
         }
         
+        //==============================================================================================================
+        // Reads a "move <amount> from <stack> to <stack>" line
         [[nodiscard]]
-        std::vector<IcmsDocument::Instruction> parseInstructions(decltype(lines.begin()) &it)
+        static IcmsDocument::Instruction parseInstruction(std::string_view line, int lineNumber, std::size_t stackCount)
         {
-            std::vector<IcmsDocument::Instruction> instructions;
+            const char *pos = line.data();
+            const char *end = line.data() + line.size();
+            
+            const auto skip_whitespace = [&pos, end]()
+            {
+                while (pos != end && aoc::isWhitespace(*pos))
+                {
+                    (void) ++pos;
+                }
+            };
             
-            for (; it != lines.end(); ++it)
+            const auto read_keyword = [&](std::string_view keyword)
             {
-                std::string line     = *it;
-                const int   line_num = static_cast<int>(std::distance(lines.begin(), it) + 1);
+                skip_whitespace();
                 
-                if (aoc::isEmptyLine(line))
+                if (static_cast<std::size_t>(end - pos) < keyword.size()
+                    || std::string_view(pos, keyword.size()) != keyword)
                 {
-                    continue;
+                    parseError("expected '" + std::string(keyword) + "' in instruction", lineNumber);
                 }
                 
-                std::vector<std::string> arguments;
-                std::size_t              pos;
+                pos += keyword.size();
+            };
+            
+            const auto read_number = [&]()
+            {
+                skip_whitespace();
+                
+                int value = 0;
                 
-                while ((pos = line.find(' ')) != std::string::npos)
+                if (const auto [ptr, error] = std::from_chars(pos, end, value); error == std::errc{} && value >= 0)
                 {
-                    (void) arguments.emplace_back(line.substr(0, pos));
-                    (void) line.erase(0, pos + 1);
+                    pos = ptr;
+                    return value;
                 }
-                arguments.emplace_back(line);
                 
-                instructions.emplace_back(IcmsDocument::Instruction{
-                    std::stoi(arguments[1]),
-                    std::stoi(arguments[3]),
-                    std::stoi(arguments[5])
-                });
+                parseError("expected a number in instruction", lineNumber);
+                return 0;
+            };
+            
+            IcmsDocument::Instruction instruction {};
+            
+            read_keyword("move");
+            instruction.amount = read_number();
+            read_keyword("from");
+            instruction.from = read_number();
+            read_keyword("to");
+            instruction.to = read_number();
+            skip_whitespace();
+            
+            if (pos != end)
+            {
+                parseError("unexpected characters after instruction", lineNumber);
             }
             
-            return instructions;
+            for (const int stack : { instruction.from, instruction.to })
+            {
+                if (stack < 1 || static_cast<std::size_t>(stack) > stackCount)
+                {
+                    parseError("there is no stack number " + std::to_string(stack), lineNumber);
+                }
+            }
+            
+            return instruction;
         }
     };
-}
-//======================================================================================================================
-// endregion Namespace
-//**********************************************************************************************************************
-// region Main
-//======================================================================================================================
-int main()
-{
-    ::IcmsDocument document;
-            
-    try
-    {
-        document = ::IcmsParser::parseDocument(INPUT_FILE);
-    }
-    catch (const std::exception &ex)
-    {
-        std::cout << "Exception caught: " << ex.what();
-        return 1;
-    }
-    
-    for (const auto &[amount, from, to] : document.getInstructions())
-    {
-        ::IcmsDocument::Stack &from_stack = document.getStacks()[from - 1];
-        ::IcmsDocument::Stack &to_stack   = document.getStacks()[to - 1];
-        to_stack.putOn(from_stack.takeOff(amount));
-    }
-    
-    std::cout << "The crate that ends up on each stack is: ";
-    
-    for (const ::IcmsDocument::Stack &stack : document.getStacks())
-    {
-        std::cout << stack.topCrate().id;
-    }
-    
-    std::cout << '\n';
-    
-    try
-    {
-        document = ::IcmsParser::parseDocument(INPUT_FILE);
-    }
-    catch (const std::exception &ex)
-    {
-        std::cout << "Exception caught: " << ex.what();
-        return 1;
-    }
-    
-    for (const auto &[amount, from, to] : document.getInstructions())
-    {
-        ::IcmsDocument::Stack &from_stack = document.getStacks()[from - 1];
-        ::IcmsDocument::Stack &to_stack   = document.getStacks()[to - 1];
-        to_stack.putOn(from_stack.liftOff(amount));
-    }
     
-    std::cout << "The crate that ends up on each stack after a complete lift off is: ";
-    
-    for (const ::IcmsDocument::Stack &stack : document.getStacks())
+    //==================================================================================================================
+    // A compact binary form of an already validated ICMS document, which can be loaded again without any tokenising.
+    // Everything is stored in native byte order, so a file is only meant to be read on the machine that wrote it:
+    //
+    // - Header
+    // - The end offset of every stack's crates and id, as 64-bit values
+    // - All instructions as packed triples of 32-bit values
+    // - All crate ids, stack by stack from bottom to top
+    // - All stack ids
+    class IcmsBinaryFormat
     {
-        std::cout << stack.topCrate().id;
+    public:
+        /** Writes the document to the given file. */
+        static void write(const IcmsDocument &document, const std::string &file)
+        {
+            std::ofstream output(file, std::ios::binary | std::ios::trunc);
+            
+            if (!output.is_open())
+            {
+                throw std::runtime_error("File '" + file + "' couldn't be opened for writing");
+            }
+            
+            const std::vector<IcmsDocument::Stack>       &stacks       = document.getStacks();
+            const std::vector<IcmsDocument::Instruction> &instructions = document.getInstructions();
+            
+            std::vector<std::uint64_t> crate_ends;
+            std::vector<std::uint64_t> id_ends;
+            std::string                crates;
+            std::string                ids;
+            
+            for (const IcmsDocument::Stack &stack : stacks)
+            {
+                for (int i = 0; i < static_cast<int>(stack.size()); ++i)
+                {
+                    crates += stack.readCrate(i).id;
+                }
+                
+                ids += stack.getId();
+                crate_ends.push_back(crates.size());
+                id_ends   .push_back(ids.size());
+            }
+            
+            const Header header {
+                { 'I', 'C', 'M', 'S', 'B', 'I', 'N', '1' },
+                stacks.size(),
+                instructions.size(),
+                crates.size(),
+                ids.size()
+            };
+            
+            const auto write_bytes = [&output](const void *data, std::size_t size)
+            {
+                (void) output.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            };
+            
+            write_bytes(&header,             sizeof(Header));
+            write_bytes(crate_ends.data(),   crate_ends.size()   * sizeof(std::uint64_t));
+            write_bytes(id_ends.data(),      id_ends.size()      * sizeof(std::uint64_t));
+            write_bytes(instructions.data(), instructions.size() * sizeof(IcmsDocument::Instruction));
+            write_bytes(crates.data(),       crates.size());
+            write_bytes(ids.data(),          ids.size());
+            
+            if (!output)
+            {
+                throw std::runtime_error("Failed writing to file '" + file + "'");
+            }
+        }
+        
+        /**
+            Loads a document written by write(). The layout and the instructions are checked, so a file that was
+            corrupted or edited since can't make the cranes reach for stacks that don't exist.
+         */
+        [[nodiscard]]
+        static IcmsDocument load(const char *file)
+        {
+            const aoc::MappedFile input(file);
+            const char *const     data = input.data();
+            Header                header {};
+            
+            if (input.size() >= sizeof(Header))
+            {
+                std::memcpy(&header, data, sizeof(Header));
+            }
+            
+            if (std::string_view(header.magic, sizeof(header.magic)) != "ICMSBIN1")
+            {
+                throw std::runtime_error("File '" + std::string(file) + "' is not a binary ICMS document");
+            }
+            
+            const std::size_t tables_offset       = sizeof(Header);
+            const std::size_t instructions_offset = tables_offset + header.stackCount * 2 * sizeof(std::uint64_t);
+            const std::size_t crates_offset       = instructions_offset
+                                                    + header.instructionCount * sizeof(IcmsDocument::Instruction);
+            const std::size_t ids_offset          = crates_offset + header.crateBytes;
+            
+            if (header.stackCount > input.size() || header.instructionCount > input.size()
+                || header.crateBytes > input.size() || header.idBytes > input.size()
+                || (ids_offset + header.idBytes) != input.size())
+            {
+                throw std::runtime_error("Binary ICMS document '" + std::string(file) + "' is truncated or corrupt");
+            }
+            
+            std::vector<std::uint64_t> ends(header.stackCount * 2);
+            std::memcpy(ends.data(), data + tables_offset, ends.size() * sizeof(std::uint64_t));
+            
+            std::vector<IcmsDocument::Stack> stacks;
+            stacks.reserve(header.stackCount);
+            
+            std::uint64_t crate_begin = 0;
+            std::uint64_t id_begin    = 0;
+            
+            for (std::size_t i = 0; i < header.stackCount; ++i)
+            {
+                const std::uint64_t crate_end = ends[i];
+                const std::uint64_t id_end    = ends[header.stackCount + i];
+                
+                if (crate_end < crate_begin || crate_end > header.crateBytes
+                    || id_end < id_begin || id_end > header.idBytes)
+                {
+                    throw std::runtime_error("Binary ICMS document '" + std::string(file) + "' is corrupt");
+                }
+                
+                IcmsDocument::Stack &stack = stacks.emplace_back(std::string(data + ids_offset + id_begin,
+                                                                             id_end - id_begin));
+                stack.reserve(crate_end - crate_begin);
+                stack.putOn(std::string_view(data + crates_offset + crate_begin, crate_end - crate_begin));
+                
+                crate_begin = crate_end;
+                id_begin    = id_end;
+            }
+            
+            std::vector<IcmsDocument::Instruction> instructions(header.instructionCount);
+            std::memcpy(instructions.data(), data + instructions_offset,
+                        instructions.size() * sizeof(IcmsDocument::Instruction));
+            
+            for (std::size_t i = 0; i < instructions.size(); ++i)
+            {
+                const auto &[amount, from, to] = instructions[i];
+                
+                if (amount < 0 || from < 1 || to < 1 || static_cast<std::uint64_t>(from) > header.stackCount
+                    || static_cast<std::uint64_t>(to) > header.stackCount)
+                {
+                    throw std::runtime_error("Binary ICMS document '" + std::string(file) + "' has an invalid instruction "
+                                             + std::to_string(i + 1));
+                }
+            }
+            
+            return { std::move(stacks), std::move(instructions) };
+        }
+        
+        /**
+            Writes the document to the given file and loads it again, which has to give the same document back.
+            Then patches the first instruction of the file to reach for a stack that doesn't exist, which load() has to
+            reject. Returns whether both checks passed.
+         */
+        [[nodiscard]]
+        static bool checkRoundTrip(const IcmsDocument &document, const std::string &file)
+        {
+            write(document, file);
+            
+            const IcmsDocument loaded = load(file.c_str());
+            bool               same   = (loaded.getStacks().size()       == document.getStacks().size()
+                                         && loaded.getInstructions().size() == document.getInstructions().size());
+            
+            for (std::size_t i = 0; same && i < document.getStacks().size(); ++i)
+            {
+                const IcmsDocument::Stack &expected = document.getStacks()[i];
+                const IcmsDocument::Stack &actual   = loaded  .getStacks()[i];
+                
+                same = (actual.getId() == expected.getId() && actual.size() == expected.size());
+                
+                for (int j = 0; same && j < static_cast<int>(expected.size()); ++j)
+                {
+                    same = (actual.readCrate(j).id == expected.readCrate(j).id);
+                }
+            }
+            
+            for (std::size_t i = 0; same && i < document.getInstructions().size(); ++i)
+            {
+                const IcmsDocument::Instruction &expected = document.getInstructions()[i];
+                const IcmsDocument::Instruction &actual   = loaded  .getInstructions()[i];
+                
+                same = (actual.amount == expected.amount && actual.from == expected.from && actual.to == expected.to);
+            }
+            
+            std::cout << "Binary round trip " << (same ? "passed" : "FAILED") << '\n';
+            
+            if (document.getInstructions().empty())
+            {
+                return same;
+            }
+            
+            const std::string patched_file = file + ".patched";
+            
+            {
+                std::string bytes;
+                
+                {
+                    const aoc::MappedFile input(file);
+                    bytes.assign(input.data(), input.size());
+                }
+                
+                const IcmsDocument::Instruction bad_instruction {
+                    1'000'000, static_cast<int>(document.getStacks().size()) + 1, 1
+                };
+                std::memcpy(bytes.data() + sizeof(Header) + document.getStacks().size() * 2 * sizeof(std::uint64_t),
+                            &bad_instruction, sizeof(IcmsDocument::Instruction));
+                
+                std::ofstream output(patched_file, std::ios::binary | std::ios::trunc);
+                (void) output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            }
+            
+            bool rejected = false;
+            
+            try
+            {
+                (void) load(patched_file.c_str());
+            }
+            catch (const std::runtime_error &ex)
+            {
+                rejected = true;
+                std::cout << "Patched file rejected: " << ex.what() << '\n';
+            }
+            
+            (void) std::remove(patched_file.c_str());
+            std::cout << "Binary check of a patched instruction " << (rejected ? "passed" : "FAILED") << '\n';
+            
+            return (same && rejected);
+        }
+        
+    private:
+        struct Header
+        {
+            char          magic[8]; // NOLINT
+            std::uint64_t stackCount;
+            std::uint64_t instructionCount;
+            std::uint64_t crateBytes;
+            std::uint64_t idBytes;
+        };
+        
+        static_assert(std::is_trivially_copyable_v<IcmsDocument::Instruction>
+                          && sizeof(IcmsDocument::Instruction) == (3 * sizeof(std::int32_t)),
+                      "instructions are stored as packed triples of 32-bit values");
+    };
+    
+    //==================================================================================================================
+    // All stacks as implicit treaps sharing one pool of nodes, so moving any amount of crates costs O(log n).
+    // The position of a crate is only implied by the sizes of the subtrees left of it, which means the top crates can
+    // be split off and joined onto another stack without touching them; reversing them just flips a flag on the root.
+    class CrateTreap
+    {
+    public:
+        explicit CrateTreap(const std::vector<IcmsDocument::Stack> &stacks)
+        {
+            std::size_t crate_count = 0;
+            
+            for (const IcmsDocument::Stack &stack : stacks)
+            {
+                crate_count += stack.size();
+            }
+            
+            nodes.reserve(crate_count);
+            roots.reserve(stacks.size());
+            
+            for (const IcmsDocument::Stack &stack : stacks)
+            {
+                int root = none;
+                
+                for (int i = 0; i < static_cast<int>(stack.size()); ++i)
+                {
+                    root = merge(root, createNode(stack.readCrate(i).id));
+                }
+                
+                roots.push_back(root);
+            }
+        }
+        
+        //==============================================================================================================
+        /** Gets the number of stacks. */
+        [[nodiscard]]
+        std::size_t stackCount() const noexcept
+        {
+            return roots.size();
+        }
+        
+        /** Gets the number of crates on a stack. */
+        [[nodiscard]]
+        int size(std::size_t stack) const noexcept
+        {
+            return sizeOf(roots[stack]);
+        }
+        
+        //==============================================================================================================
+        /** Moves a number of crates one by one, which reverses their order. */
+        void takeOff(int amount, std::size_t from, std::size_t to)
+        {
+            move(amount, from, to, true);
+        }
+        
+        /** Moves a number of crates all at once, which keeps their order. */
+        void liftOff(int amount, std::size_t from, std::size_t to)
+        {
+            move(amount, from, to, false);
+        }
+        
+        //==============================================================================================================
+        /** Reads the sticker on the crate, counted from the bottom. UB if index is out of bounds. */
+        [[nodiscard]]
+        char readCrate(std::size_t stack, int index) const noexcept
+        {
+            int  node    = roots[stack];
+            bool flipped = false;
+            
+            while (true)
+            {
+                const Node &current = nodes[static_cast<std::size_t>(node)];
+                flipped ^= current.reversed;
+                
+                const int below     = (flipped ? current.right : current.left);
+                const int above     = (flipped ? current.left  : current.right);
+                const int below_len = sizeOf(below);
+                
+                if (index == below_len)
+                {
+                    return current.id;
+                }
+                
+                if (index < below_len)
+                {
+                    node = below;
+                }
+                else
+                {
+                    index -= below_len + 1;
+                    node   = above;
+                }
+            }
+        }
+        
+        /** Reads the sticker on the top crate, 0 if the stack is empty. */
+        [[nodiscard]]
+        char topCrate(std::size_t stack) const noexcept
+        {
+            const int crates = size(stack);
+            return (crates > 0 ? readCrate(stack, crates - 1) : '\0');
+        }
+        
+    private:
+        struct Node
+        {
+            std::uint32_t priority;
+            int           left     { none };
+            int           right    { none };
+            int           size     { 1 };
+            char          id;
+            bool          reversed { false };
+        };
+        
+        //==============================================================================================================
+        static constexpr int none = -1;
+        
+        //==============================================================================================================
+        std::vector<Node> nodes;
+        std::vector<int>  roots;
+        std::mt19937      generator { 5 };
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        int createNode(char id)
+        {
+            nodes.push_back(Node{ static_cast<std::uint32_t>(generator()), none, none, 1, id, false });
+            return static_cast<int>(nodes.size() - 1);
+        }
+        
+        [[nodiscard]]
+        int sizeOf(int node) const noexcept
+        {
+            return (node == none ? 0 : nodes[static_cast<std::size_t>(node)].size);
+        }
+        
+        // Applies a pending reversal to the children, so the node's own links can be followed and changed
+        void push(int node) noexcept
+        {
+            Node &current = nodes[static_cast<std::size_t>(node)];
+            
+            if (current.reversed)
+            {
+                std::swap(current.left, current.right);
+                current.reversed = false;
+                
+                for (const int child : { current.left, current.right })
+                {
+                    if (child != none)
+                    {
+                        nodes[static_cast<std::size_t>(child)].reversed ^= true;
+                    }
+                }
+            }
+        }
+        
+        void update(int node) noexcept
+        {
+            Node &current = nodes[static_cast<std::size_t>(node)];
+            current.size  = sizeOf(current.left) + sizeOf(current.right) + 1;
+        }
+        
+        //==============================================================================================================
+        [[nodiscard]]
+        int merge(int lower, int upper) noexcept
+        {
+            if (lower == none || upper == none)
+            {
+                return (lower == none ? upper : lower);
+            }
+            
+            if (nodes[static_cast<std::size_t>(lower)].priority > nodes[static_cast<std::size_t>(upper)].priority)
+            {
+                push(lower);
+                const int right = merge(nodes[static_cast<std::size_t>(lower)].right, upper);
+                nodes[static_cast<std::size_t>(lower)].right = right;
+                update(lower);
+                return lower;
+            }
+            
+            push(upper);
+            const int left = merge(lower, nodes[static_cast<std::size_t>(upper)].left);
+            nodes[static_cast<std::size_t>(upper)].left = left;
+            update(upper);
+            return upper;
+        }
+        
+        // Splits off the bottom count crates, returns the bottom and the rest on top of it
+        [[nodiscard]]
+        std::pair<int, int> split(int node, int count) noexcept
+        {
+            if (node == none)
+            {
+                return { none, none };
+            }
+            
+            push(node);
+            Node &current = nodes[static_cast<std::size_t>(node)];
+            
+            if (sizeOf(current.left) >= count)
+            {
+                const auto [lower, upper] = split(current.left, count);
+                nodes[static_cast<std::size_t>(node)].left = upper;
+                update(node);
+                return { lower, node };
+            }
+            
+            const auto [lower, upper] = split(current.right, count - sizeOf(current.left) - 1);
+            nodes[static_cast<std::size_t>(node)].right = lower;
+            update(node);
+            return { node, upper };
+        }
+        
+        void move(int amount, std::size_t from, std::size_t to, bool reverse) noexcept
+        {
+            auto [rest, moved] = split(roots[from], sizeOf(roots[from]) - amount);
+            
+            if (reverse && moved != none)
+            {
+                nodes[static_cast<std::size_t>(moved)].reversed ^= true;
+            }
+            
+            if (from == to)
+            {
+                roots[from] = merge(rest, moved);
+                return;
+            }
+            
+            roots[from] = rest;
+            roots[to]   = merge(roots[to], moved);
+        }
+    };
+    
+    //==================================================================================================================
+    /** Which way a crane moves multiple crates. */
+    enum class Crane
+    {
+        /** One crate after the other, which reverses their order. */
+        TakeOff,
+        
+        /** All crates at once, which keeps their order. */
+        LiftOff
+    };
+    
+    //==================================================================================================================
+    // Merges two instructions that run right after each other into at most one, if the crane allows it.
+    // Returns nothing if they can't be merged, an instruction with an amount of 0 if they cancel each other out.
+    //
+    // A take off reverses the crates, so two take offs from A to B are one big take off, and taking some crates from B
+    // back to A just puts the first of them back where they were. A lift off keeps the order, moving the crates back
+    // only restores A if all of them go back, and two lift offs from A to B stack the crates in a different order than
+    // one would, so they can't be merged.
+    [[nodiscard]]
+    std::optional<IcmsDocument::Instruction> mergeInstructions(const IcmsDocument::Instruction &first,
+                                                               const IcmsDocument::Instruction &second,
+                                                               Crane                           crane) noexcept
+    {
+        if (first.from == first.to || second.from == second.to)
+        {
+            // Only reversing the same crates twice undoes a move onto the same stack
+            if (crane == Crane::TakeOff && first.from == first.to && second.from == second.to
+                && first.from == second.from && first.amount == second.amount)
+            {
+                return IcmsDocument::Instruction{ 0, first.from, first.to };
+            }
+            
+            return std::nullopt;
+        }
+        
+        if (first.from == second.to && first.to == second.from)
+        {
+            if (first.amount == second.amount)
+            {
+                return IcmsDocument::Instruction{ 0, first.from, first.to };
+            }
+            
+            if (crane == Crane::TakeOff)
+            {
+                return (first.amount > second.amount
+                            ? IcmsDocument::Instruction{ first.amount - second.amount, first.from,  first.to  }
+                            : IcmsDocument::Instruction{ second.amount - first.amount, second.from, second.to });
+            }
+            
+            return std::nullopt;
+        }
+        
+        if (crane == Crane::TakeOff && first.from == second.from && first.to == second.to
+            && first.amount <= (std::numeric_limits<int>::max() - second.amount))
+        {
+            return IcmsDocument::Instruction{ first.amount + second.amount, first.from, first.to };
+        }
+        
+        return std::nullopt;
+    }
+    
+    // Removes the redundant work from the instructions for the given crane, the final stacks stay the same.
+    // The output is used like a stack, so whatever is left of a merge is merged with the instruction before it again.
+    [[nodiscard]]
+    std::vector<IcmsDocument::Instruction> optimizeInstructions(const std::vector<IcmsDocument::Instruction> &instructions,
+                                                                Crane                                        crane)
+    {
+        std::vector<IcmsDocument::Instruction> result;
+        result.reserve(instructions.size());
+        
+        for (IcmsDocument::Instruction instruction : instructions)
+        {
+            // Moving nothing, or moving crates onto the stack they came from without turning them around, does nothing
+            const bool no_op = (instruction.amount == 0
+                                || (instruction.from == instruction.to
+                                    && (crane == Crane::LiftOff || instruction.amount == 1)));
+            
+            while (!no_op && !result.empty())
+            {
+                const std::optional<IcmsDocument::Instruction> merged
+                    = mergeInstructions(result.back(), instruction, crane);
+                
+                if (!merged.has_value())
+                {
+                    break;
+                }
+                
+                result.pop_back();
+                instruction = *merged;
+                
+                if (instruction.amount == 0)
+                {
+                    break;
+                }
+            }
+            
+            if (!no_op && instruction.amount > 0)
+            {
+                result.push_back(instruction);
+            }
+        }
+        
+        return result;
+    }
+    
+    [[nodiscard]]
+    std::uint64_t countCrateMoves(const std::vector<IcmsDocument::Instruction> &instructions) noexcept
+    {
+        std::uint64_t result = 0;
+        
+        for (const IcmsDocument::Instruction &instruction : instructions)
+        {
+            result += static_cast<std::uint64_t>(instruction.amount);
+        }
+        
+        return result;
+    }
+    
+    //==================================================================================================================
+    void runInstruction(std::vector<IcmsDocument::Stack> &stacks,
+                        const IcmsDocument::Instruction  &instruction,
+                        Crane                            crane)
+    {
+        IcmsDocument::Stack &from_stack = stacks[static_cast<std::size_t>(instruction.from - 1)];
+        IcmsDocument::Stack &to_stack   = stacks[static_cast<std::size_t>(instruction.to   - 1)];
+        
+        if (crane == Crane::TakeOff)
+        {
+            from_stack.takeOff(instruction.amount, to_stack);
+        }
+        else
+        {
+            from_stack.liftOff(instruction.amount, to_stack);
+        }
+    }
+    
+    void runInstructions(std::vector<IcmsDocument::Stack>             &stacks,
+                         const std::vector<IcmsDocument::Instruction> &instructions,
+                         Crane                                        crane)
+    {
+        for (const IcmsDocument::Instruction &instruction : instructions)
+        {
+            runInstruction(stacks, instruction, crane);
+        }
+    }
+    
+    void runInstructions(CrateTreap &stacks, const std::vector<IcmsDocument::Instruction> &instructions, Crane crane)
+    {
+        for (const auto &[amount, from, to] : instructions)
+        {
+            const auto from_index = static_cast<std::size_t>(from - 1);
+            const auto to_index   = static_cast<std::size_t>(to   - 1);
+            
+            if (crane == Crane::TakeOff)
+            {
+                stacks.takeOff(amount, from_index, to_index);
+            }
+            else
+            {
+                stacks.liftOff(amount, from_index, to_index);
+            }
+        }
+    }
+    
+    //==================================================================================================================
+    [[nodiscard]]
+    std::string readTopCrates(const std::vector<IcmsDocument::Stack> &stacks)
+    {
+        std::string result;
+        
+        for (const IcmsDocument::Stack &stack : stacks)
+        {
+            if (stack.size() > 0)
+            {
+                result += stack.topCrate().id;
+            }
+        }
+        
+        return result;
+    }
+    
+    [[nodiscard]]
+    std::string readTopCrates(const CrateTreap &stacks)
+    {
+        std::string result;
+        
+        for (std::size_t i = 0; i < stacks.stackCount(); ++i)
+        {
+            if (const char id = stacks.topCrate(i); id != 0)
+            {
+                result += id;
+            }
+        }
+        
+        return result;
+    }
+    
+    //==================================================================================================================
+    // Which instructions have to wait for which. An instruction only depends on the last instructions before it that
+    // touched its from or to stack, everything else can run at the same time.
+    class InstructionGraph
+    {
+    public:
+        InstructionGraph(std::size_t stackCount, const std::vector<IcmsDocument::Instruction> &instructions)
+            : dependencyCounts(instructions.size(), 0),
+              successorOffsets(instructions.size() + 1, 0)
+        {
+            // First count the successors of every instruction, then fill them in, both times the same way
+            const auto for_each_dependency = [&](auto &&callback)
+            {
+                std::vector<std::size_t> last_user(stackCount, none);
+                
+                for (std::size_t i = 0; i < instructions.size(); ++i)
+                {
+                    const auto from = static_cast<std::size_t>(instructions[i].from - 1);
+                    const auto to   = static_cast<std::size_t>(instructions[i].to   - 1);
+                    
+                    if (last_user[from] != none)
+                    {
+                        callback(last_user[from], i);
+                    }
+                    
+                    if (last_user[to] != none && last_user[to] != last_user[from])
+                    {
+                        callback(last_user[to], i);
+                    }
+                    
+                    last_user[from] = i;
+                    last_user[to]   = i;
+                }
+            };
+            
+            for_each_dependency([this](std::size_t before, std::size_t after)
+            {
+                (void) ++successorOffsets[before + 1];
+                (void) ++dependencyCounts[after];
+            });
+            
+            std::partial_sum(successorOffsets.begin(), successorOffsets.end(), successorOffsets.begin());
+            successors.resize(successorOffsets.back());
+            
+            std::vector<std::size_t> filled(successorOffsets.begin(), successorOffsets.end() - 1);
+            for_each_dependency([this, &filled](std::size_t before, std::size_t after)
+            {
+                successors[filled[before]++] = after;
+            });
+        }
+        
+        //==============================================================================================================
+        /** Gets how many instructions the instruction has to wait for. */
+        [[nodiscard]]
+        int getDependencyCount(std::size_t instruction) const noexcept
+        {
+            return dependencyCounts[instruction];
+        }
+        
+        /** Calls the callback for every instruction waiting on the given instruction. */
+        template<class Fn>
+        void forEachSuccessor(std::size_t instruction, Fn &&callback) const
+        {
+            for (std::size_t i = successorOffsets[instruction]; i < successorOffsets[instruction + 1]; ++i)
+            {
+                callback(successors[i]);
+            }
+        }
+        
+    private:
+        static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+        
+        //==============================================================================================================
+        std::vector<int>         dependencyCounts;
+        std::vector<std::size_t> successorOffsets;
+        std::vector<std::size_t> successors;
+    };
+    
+    // Runs the instructions on the pool, each one as soon as everything it depends on is done.
+    // A finished instruction carries on with one of the instructions it released itself and leaves the others to the
+    // pool, so chains of dependent moves don't go through the queues at all.
+    void runInstructionsParallel(std::vector<IcmsDocument::Stack>             &stacks,
+                                 const std::vector<IcmsDocument::Instruction> &instructions,
+                                 const InstructionGraph                       &graph,
+                                 Crane                                        crane,
+                                 aoc::WorkStealingPool                        &pool)
+    {
+        if (instructions.empty())
+        {
+            return;
+        }
+        
+        constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+        
+        std::vector<std::atomic<int>> waiting(instructions.size());
+        std::atomic<std::size_t>      remaining(instructions.size());
+        std::promise<void>            finished;
+        
+        for (std::size_t i = 0; i < instructions.size(); ++i)
+        {
+            waiting[i].store(graph.getDependencyCount(i), std::memory_order_relaxed);
+        }
+        
+        std::function<void(std::size_t)> run = [&](std::size_t instruction)
+        {
+            while (instruction != none)
+            {
+                runInstruction(stacks, instructions[instruction], crane);
+                
+                std::size_t next = none;
+                
+                graph.forEachSuccessor(instruction, [&](std::size_t successor)
+                {
+                    if (waiting[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        if (next == none)
+                        {
+                            next = successor;
+                        }
+                        else
+                        {
+                            pool.submit([&run, successor]() { run(successor); });
+                        }
+                    }
+                });
+                
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    finished.set_value();
+                }
+                
+                instruction = next;
+            }
+        };
+        
+        for (std::size_t i = 0; i < instructions.size(); ++i)
+        {
+            if (graph.getDependencyCount(i) == 0)
+            {
+                pool.submit([&run, i]() { run(i); });
+            }
+        }
+        
+        finished.get_future().wait();
+    }
+    
+    //==================================================================================================================
+    // Finds the final top crates without moving a single crate. The final height of every stack only needs the amounts,
+    // from there the position of each top crate is followed backwards through the instructions to where it started.
+    [[nodiscard]]
+    std::string replayTopCrates(const std::vector<IcmsDocument::Stack>       &stacks,
+                                const std::vector<IcmsDocument::Instruction> &instructions,
+                                Crane                                        crane)
+    {
+        std::vector<int> sizes;
+        sizes.reserve(stacks.size());
+        
+        for (const IcmsDocument::Stack &stack : stacks)
+        {
+            sizes.push_back(static_cast<int>(stack.size()));
+        }
+        
+        for (const auto &[amount, from, to] : instructions)
+        {
+            sizes[static_cast<std::size_t>(from - 1)] -= amount;
+            sizes[static_cast<std::size_t>(to   - 1)] += amount;
+        }
+        
+        // The stack and position each final top crate is on, as of the instruction currently undone
+        struct Position
+        {
+            std::size_t stack;
+            int         index;
+        };
+        
+        std::vector<Position> tops;
+        
+        for (std::size_t i = 0; i < sizes.size(); ++i)
+        {
+            if (sizes[i] > 0)
+            {
+                tops.push_back({ i, sizes[i] - 1 });
+            }
+        }
+        
+        for (auto it = instructions.rbegin(); it != instructions.rend(); ++it)
+        {
+            const auto &[amount, from, to] = *it;
+            const auto from_index = static_cast<std::size_t>(from - 1);
+            const auto to_index   = static_cast<std::size_t>(to   - 1);
+            
+            // Where the moved crates ended up, and where they were taken from before the move
+            const int moved_to   = sizes[to_index] - amount;
+            sizes[to_index]     -= amount;
+            sizes[from_index]   += amount;
+            const int moved_from = sizes[from_index] - amount;
+            
+            for (Position &top : tops)
+            {
+                if (top.stack == to_index && top.index >= moved_to)
+                {
+                    const int offset = top.index - moved_to;
+                    
+                    top.stack = from_index;
+                    top.index = moved_from + (crane == Crane::TakeOff ? (amount - 1 - offset) : offset);
+                }
+            }
+        }
+        
+        std::string result;
+        
+        for (const Position &top : tops)
+        {
+            result += stacks[top.stack].readCrate(top.index).id;
+        }
+        
+        return result;
+    }
+    
+    //==================================================================================================================
+    template<class Fn>
+    [[nodiscard]]
+    double measureMilliseconds(Fn &&function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    // Compares the backends and the reverse replay on a few stacks holding millions of crates, where every instruction
+    // moves a big part of one stack. The list backend is how stacks were stored at first, one heap node per crate.
+    void runBackendBenchmark()
+    {
+        constexpr std::size_t stackCount       = 9;
+        constexpr int         cratesPerStack   = 400'000;
+        constexpr std::size_t instructionCount = 2'000;
+        
+        std::mt19937 generator(2022);
+        
+        std::vector<IcmsDocument::Stack> stacks;
+        std::vector<int>                 sizes(stackCount, cratesPerStack);
+        
+        for (std::size_t i = 0; i < stackCount; ++i)
+        {
+            IcmsDocument::Stack &stack = stacks.emplace_back(std::to_string(i + 1));
+            
+            for (int j = 0; j < cratesPerStack; ++j)
+            {
+                stack.putOn(IcmsDocument::Crate{ static_cast<char>('A' + generator() % 26) });
+            }
+        }
+        
+        std::vector<IcmsDocument::Instruction> instructions;
+        std::uniform_int_distribution<std::size_t> stack_distribution(0, stackCount - 1);
+        
+        while (instructions.size() < instructionCount)
+        {
+            const std::size_t from = stack_distribution(generator);
+            const std::size_t to   = stack_distribution(generator);
+            
+            if (from == to || sizes[from] == 0)
+            {
+                continue;
+            }
+            
+            const int amount = std::uniform_int_distribution<int>(sizes[from] / 2, sizes[from])(generator);
+            sizes[from] -= amount;
+            sizes[to]   += amount;
+            
+            instructions.push_back({ amount, static_cast<int>(from + 1), static_cast<int>(to + 1) });
+        }
+        
+        std::cout << std::fixed << std::setprecision(2) << instructions.size() << " instructions over "
+                  << (stackCount * cratesPerStack) << " crates:\n";
+        
+        for (const Crane crane : { Crane::TakeOff, Crane::LiftOff })
+        {
+            std::vector<std::list<char>> list_stacks;
+            
+            for (const IcmsDocument::Stack &stack : stacks)
+            {
+                std::list<char> &list = list_stacks.emplace_back();
+                
+                for (int i = 0; i < static_cast<int>(stack.size()); ++i)
+                {
+                    list.push_back(stack.readCrate(i).id);
+                }
+            }
+            
+            std::string list_result;
+            const double list_time = measureMilliseconds([&]()
+            {
+                std::vector<char> moved;
+                
+                for (const auto &[amount, from, to] : instructions)
+                {
+                    std::list<char> &from_list = list_stacks[static_cast<std::size_t>(from - 1)];
+                    std::list<char> &to_list   = list_stacks[static_cast<std::size_t>(to   - 1)];
+                    
+                    moved.clear();
+                    
+                    for (int i = 0; i < amount; ++i)
+                    {
+                        moved.push_back(from_list.back());
+                        from_list.pop_back();
+                    }
+                    
+                    if (crane == Crane::TakeOff)
+                    {
+                        to_list.insert(to_list.end(), moved.begin(), moved.end());
+                    }
+                    else
+                    {
+                        to_list.insert(to_list.end(), moved.rbegin(), moved.rend());
+                    }
+                }
+                
+                for (const std::list<char> &list : list_stacks)
+                {
+                    if (!list.empty())
+                    {
+                        list_result += list.back();
+                    }
+                }
+            });
+            
+            std::vector<IcmsDocument::Stack> vector_stacks = stacks;
+            std::string                      vector_result;
+            const double vector_time = measureMilliseconds([&]()
+            {
+                runInstructions(vector_stacks, instructions, crane);
+                vector_result = readTopCrates(vector_stacks);
+            });
+            
+            std::optional<CrateTreap> treap_stacks;
+            std::string               treap_result;
+            const double treap_build_time = measureMilliseconds([&]() { treap_stacks.emplace(stacks); });
+            const double treap_time       = measureMilliseconds([&]()
+            {
+                runInstructions(*treap_stacks, instructions, crane);
+                treap_result = readTopCrates(*treap_stacks);
+            });
+            
+            std::string replay_result;
+            const double replay_time = measureMilliseconds([&]()
+            {
+                replay_result = replayTopCrates(stacks, instructions, crane);
+            });
+            
+            const bool matches = (list_result == vector_result && list_result == treap_result
+                                  && list_result == replay_result);
+            
+            std::cout << (crane == Crane::TakeOff ? "  take off: " : "  lift off: ")
+                      << "list " << list_time << " ms, vector " << vector_time << " ms, treap " << treap_time
+                      << " ms (+" << treap_build_time << " ms build), replay " << replay_time << " ms"
+                      << (matches ? "" : " (MISMATCH)") << '\n';
+        }
+    }
+}
+//======================================================================================================================
+// endregion Namespace
+//**********************************************************************************************************************
+// region Main
+//======================================================================================================================
+int main(int argc, char **argv)
+{
+    // Usage: day_5 [--treap] [--replay] [--stream] [--parallel] [--threads N] [--optimize] [--binary]
+    //             [--save <binary file>] [--check-binary <scratch file>] [--bench] [input file]
+    bool        use_treap    = false;
+    bool        optimize     = false;
+    bool        use_replay   = false;
+    bool        use_stream   = false;
+    bool        use_parallel = false;
+    bool        use_binary   = false;
+    std::size_t thread_count = 0;
+    const char  *save_url    = nullptr;
+    const char  *check_url   = nullptr;
+    const char  *input_url   = INPUT_FILE;
+    
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg(argv[i]);
+        
+        if (arg == "--treap")
+        {
+            use_treap = true;
+        }
+        else if (arg == "--replay")
+        {
+            use_replay = true;
+        }
+        else if (arg == "--stream")
+        {
+            use_stream = true;
+        }
+        else if (arg == "--parallel")
+        {
+            use_parallel = true;
+        }
+        else if (arg == "--threads" && (i + 1) < argc)
+        {
+            thread_count = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--optimize")
+        {
+            optimize = true;
+        }
+        else if (arg == "--binary")
+        {
+            use_binary = true;
+        }
+        else if (arg == "--save" && (i + 1) < argc)
+        {
+            save_url = argv[++i];
+        }
+        else if (arg == "--check-binary" && (i + 1) < argc)
+        {
+            check_url = argv[++i];
+        }
+        else if (arg == "--bench")
+        {
+            ::runBackendBenchmark();
+            return 0;
+        }
+        else
+        {
+            input_url = argv[i];
+        }
+    }
+    
+    if (use_stream)
+    {
+        std::vector<::IcmsDocument::Stack> take_off_stacks;
+        std::vector<::IcmsDocument::Stack> lift_off_stacks;
+        
+        try
+        {
+            ::IcmsParser::streamDocument(input_url,
+                                         [&](std::vector<::IcmsDocument::Stack> stacks)
+                                         {
+                                             lift_off_stacks = stacks;
+                                             take_off_stacks = std::move(stacks);
+                                         },
+                                         [&](const ::IcmsDocument::Instruction &instruction)
+                                         {
+                                             ::runInstruction(take_off_stacks, instruction, ::Crane::TakeOff);
+                                             ::runInstruction(lift_off_stacks, instruction, ::Crane::LiftOff);
+                                         });
+        }
+        catch (const std::exception &ex)
+        {
+            std::cout << "Exception caught: " << ex.what();
+            return 1;
+        }
+        
+        std::cout << "The crate that ends up on each stack is: "
+                  << ::readTopCrates(take_off_stacks) << '\n';
+        std::cout << "The crate that ends up on each stack after a complete lift off is: "
+                  << ::readTopCrates(lift_off_stacks) << '\n';
+        
+        return 0;
+    }
+    
+    ::IcmsDocument document;
+            
+    try
+    {
+        document = (use_binary ? ::IcmsBinaryFormat::load(input_url) : ::IcmsParser::parseDocument(input_url));
+        
+        if (save_url != nullptr)
+        {
+            ::IcmsBinaryFormat::write(document, save_url);
+        }
+        
+        if (check_url != nullptr)
+        {
+            return (::IcmsBinaryFormat::checkRoundTrip(document, check_url) ? 0 : 1);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cout << "Exception caught: " << ex.what();
+        return 1;
+    }
+    
+    std::vector<::IcmsDocument::Instruction> take_off_instructions;
+    std::vector<::IcmsDocument::Instruction> lift_off_instructions;
+    
+    if (optimize)
+    {
+        take_off_instructions = ::optimizeInstructions(document.getInstructions(), ::Crane::TakeOff);
+        lift_off_instructions = ::optimizeInstructions(document.getInstructions(), ::Crane::LiftOff);
+        
+        const std::uint64_t crate_moves = ::countCrateMoves(document.getInstructions());
+        
+        std::cout << "Optimised away " << (crate_moves - ::countCrateMoves(take_off_instructions))
+                  << " crate moves for the take off crane (" << take_off_instructions.size() << " of "
+                  << document.getInstructions().size() << " instructions left) and "
+                  << (crate_moves - ::countCrateMoves(lift_off_instructions)) << " for the lift off crane ("
+                  << lift_off_instructions.size() << " left)\n";
+    }
+    
+    // The instructions each crane runs, the unchanged ones from the document if they aren't optimised
+    const std::vector<::IcmsDocument::Instruction> &take_off = (optimize ? take_off_instructions
+                                                                         : document.getInstructions());
+    const std::vector<::IcmsDocument::Instruction> &lift_off = (optimize ? lift_off_instructions
+                                                                         : document.getInstructions());
+    
+    std::string take_off_crates;
+    std::string lift_off_crates;
+    
+    if (use_replay)
+    {
+        take_off_crates = ::replayTopCrates(document.getStacks(), take_off, ::Crane::TakeOff);
+        lift_off_crates = ::replayTopCrates(document.getStacks(), lift_off, ::Crane::LiftOff);
+    }
+    else if (use_parallel)
+    {
+        ::IcmsDocument           lift_document = document.snapshot();
+        const ::InstructionGraph take_off_graph(document.getStacks().size(), take_off);
+        const ::InstructionGraph lift_off_graph(document.getStacks().size(), lift_off);
+        aoc::WorkStealingPool    pool(thread_count);
+        
+        ::runInstructionsParallel(document     .getStacks(), take_off, take_off_graph, ::Crane::TakeOff, pool);
+        ::runInstructionsParallel(lift_document.getStacks(), lift_off, lift_off_graph, ::Crane::LiftOff, pool);
+        
+        take_off_crates = ::readTopCrates(document     .getStacks());
+        lift_off_crates = ::readTopCrates(lift_document.getStacks());
+    }
+    else if (use_treap)
+    {
+        ::CrateTreap take_off_stacks(document.getStacks());
+        ::CrateTreap lift_off_stacks = take_off_stacks;
+        
+        ::runInstructions(take_off_stacks, take_off, ::Crane::TakeOff);
+        ::runInstructions(lift_off_stacks, lift_off, ::Crane::LiftOff);
+        
+        take_off_crates = ::readTopCrates(take_off_stacks);
+        lift_off_crates = ::readTopCrates(lift_off_stacks);
+    }
+    else
+    {
+        // Both cranes start from the same parsed document, the second one gets its own copy of the stacks
+        ::IcmsDocument lift_document = document.snapshot();
+        
+        ::runInstructions(document     .getStacks(), take_off, ::Crane::TakeOff);
+        ::runInstructions(lift_document.getStacks(), lift_off, ::Crane::LiftOff);
+        
+        take_off_crates = ::readTopCrates(document     .getStacks());
+        lift_off_crates = ::readTopCrates(lift_document.getStacks());
     }
     
-    std::cout << '\n';
+    std::cout << "The crate that ends up on each stack is: "                          << take_off_crates << '\n';
+    std::cout << "The crate that ends up on each stack after a complete lift off is: " << lift_off_crates << '\n';
     
     return 0;
 }